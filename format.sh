@@ -2,3 +2,5 @@ clang-format -i src/*.cpp
 clang-format -i src/*.hpp
 clang-format -i src/dsp/*.hpp
 clang-format -i test/*.cpp
+clang-format -i render/*.cpp
+clang-format -i render/*.hpp
@@ -0,0 +1,247 @@
+#include "json.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace arc {
+namespace render {
+
+// Deep enough for any spec, and shallow enough that a hostile file can't
+// overflow the stack.
+static const int kMaxDepth = 32;
+
+class Parser {
+
+    const std::string& text;
+    size_t pos = 0;
+    std::string error;
+
+    bool fail(const char* what) {
+        if (error.empty()) {
+            int line = 1;
+            for (size_t i = 0; i < pos && i < text.size(); i++) {
+                line += (text[i] == '\n');
+            }
+            error = std::string(what) + " on line " + std::to_string(line);
+        }
+        return false;
+    }
+
+    void skipSpace() {
+        while (pos < text.size()) {
+            char c = text[pos];
+            if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+                break;
+            }
+            pos++;
+        }
+    }
+
+    bool literal(const char* word) {
+        size_t n = std::strlen(word);
+        if (text.compare(pos, n, word) != 0) {
+            return fail("unexpected token");
+        }
+        pos += n;
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        pos++; // opening quote
+        while (pos < text.size()) {
+            char c = text[pos++];
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= text.size()) {
+                break;
+            }
+            // clang-format off
+            switch (text[pos++]) {
+                case '"':  out += '"';  break;
+                case '\\': out += '\\'; break;
+                case '/':  out += '/';  break;
+                case 'b':  out += '\b'; break;
+                case 'f':  out += '\f'; break;
+                case 'n':  out += '\n'; break;
+                case 'r':  out += '\r'; break;
+                case 't':  out += '\t'; break;
+                // clang-format on
+                case 'u': {
+                    // Paths and names are all a spec holds, so only the
+                    // Basic Multilingual Plane is supported.
+                    if (pos + 4 > text.size()) {
+                        return fail("bad escape");
+                    }
+                    unsigned long u = std::strtoul(text.substr(pos, 4).c_str(), NULL, 16);
+                    pos += 4;
+                    if (u < 0x80) {
+                        out += (char)u;
+                    } else if (u < 0x800) {
+                        out += (char)(0xC0 | (u >> 6));
+                        out += (char)(0x80 | (u & 0x3F));
+                    } else {
+                        out += (char)(0xE0 | (u >> 12));
+                        out += (char)(0x80 | ((u >> 6) & 0x3F));
+                        out += (char)(0x80 | (u & 0x3F));
+                    }
+                    break;
+                }
+                default:
+                    return fail("bad escape");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool parseNumber(Json& out) {
+        const char* start = text.c_str() + pos;
+        char* end = NULL;
+        out.type = Json::kNumber;
+        out.number = std::strtod(start, &end);
+        if (end == start) {
+            return fail("bad number");
+        }
+        pos += end - start;
+        return true;
+    }
+
+    bool parseArray(Json& out, int depth) {
+        out.type = Json::kArray;
+        pos++; // [
+        skipSpace();
+        if (pos < text.size() && text[pos] == ']') {
+            pos++;
+            return true;
+        }
+        while (true) {
+            out.items.push_back(Json());
+            if (!parseValue(out.items.back(), depth + 1)) {
+                return false;
+            }
+            skipSpace();
+            if (pos < text.size() && text[pos] == ',') {
+                pos++;
+            } else if (pos < text.size() && text[pos] == ']') {
+                pos++;
+                return true;
+            } else {
+                return fail("expected ',' or ']'");
+            }
+        }
+    }
+
+    bool parseObject(Json& out, int depth) {
+        out.type = Json::kObject;
+        pos++; // {
+        skipSpace();
+        if (pos < text.size() && text[pos] == '}') {
+            pos++;
+            return true;
+        }
+        while (true) {
+            skipSpace();
+            if (pos >= text.size() || text[pos] != '"') {
+                return fail("expected a key");
+            }
+            out.members.push_back(std::make_pair(std::string(), Json()));
+            if (!parseString(out.members.back().first)) {
+                return false;
+            }
+            skipSpace();
+            if (pos >= text.size() || text[pos] != ':') {
+                return fail("expected ':'");
+            }
+            pos++;
+            if (!parseValue(out.members.back().second, depth + 1)) {
+                return false;
+            }
+            skipSpace();
+            if (pos < text.size() && text[pos] == ',') {
+                pos++;
+            } else if (pos < text.size() && text[pos] == '}') {
+                pos++;
+                return true;
+            } else {
+                return fail("expected ',' or '}'");
+            }
+        }
+    }
+
+  public:
+
+    Parser(const std::string& text_) : text(text_) {
+    }
+
+    const std::string& getError() const {
+        return error;
+    }
+
+    bool parseValue(Json& out, int depth) {
+        if (depth > kMaxDepth) {
+            return fail("nested too deeply");
+        }
+        skipSpace();
+        if (pos >= text.size()) {
+            return fail("unexpected end of file");
+        }
+
+        char c = text[pos];
+        if (c == '{') {
+            return parseObject(out, depth);
+        } else if (c == '[') {
+            return parseArray(out, depth);
+        } else if (c == '"') {
+            out.type = Json::kString;
+            return parseString(out.string);
+        } else if (c == 't') {
+            out.type = Json::kBool;
+            out.boolean = true;
+            return literal("true");
+        } else if (c == 'f') {
+            out.type = Json::kBool;
+            return literal("false");
+        } else if (c == 'n') {
+            return literal("null");
+        } else {
+            return parseNumber(out);
+        }
+    }
+
+    bool parseDocument(Json& out) {
+        if (!parseValue(out, 0)) {
+            return false;
+        }
+        skipSpace();
+        if (pos != text.size()) {
+            return fail("trailing characters");
+        }
+        return true;
+    }
+};
+
+bool Json::parse(const std::string& text, Json& out, std::string& error) {
+    Parser parser(text);
+    out = Json();
+    if (!parser.parseDocument(out)) {
+        error = parser.getError();
+        return false;
+    }
+    return true;
+}
+
+const Json* Json::get(const char* key) const {
+    for (const auto& m : members) {
+        if (m.first == key) {
+            return &m.second;
+        }
+    }
+    return NULL;
+}
+
+} // namespace render
+} // namespace arc
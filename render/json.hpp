@@ -0,0 +1,38 @@
+#pragma once
+
+// A small JSON reader for render specs. The plugin reads JSON through Rack's
+// jansson, but the renderer must build without the Rack SDK, and a spec only
+// needs a handful of objects, numbers and strings.
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace arc {
+namespace render {
+
+class Json {
+
+  public:
+
+    enum Type { kNull, kBool, kNumber, kString, kArray, kObject };
+
+    Type type = kNull;
+
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<Json> items;
+    std::vector<std::pair<std::string, Json>> members;
+
+    // Parses a whole document. On failure, returns false and describes the
+    // problem and its line in error.
+    static bool parse(const std::string& text, Json& out, std::string& error);
+
+    // The member with the given key, or NULL if there is none, or if this
+    // is not an object.
+    const Json* get(const char* key) const;
+};
+
+} // namespace render
+} // namespace arc
@@ -0,0 +1,114 @@
+// arc-render: renders WAV stems through the plugin's DSP, offline, on every
+// core. See docs/render.md.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "arc_kernels.hpp"
+#include "json.hpp"
+#include "render.hpp"
+
+using namespace arc::render;
+
+static void usage() {
+    std::fprintf(stderr, "usage: arc-render [-j threads] spec.json\n");
+}
+
+static bool readFile(const std::string& path, std::string& out) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    char buffer[4096];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        out.append(buffer, n);
+    }
+    std::fclose(file);
+    return true;
+}
+
+static std::string dirName(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return (slash == std::string::npos) ? "" : path.substr(0, slash);
+}
+
+int main(int argc, char** argv) {
+
+    int threads = 0;
+    const char* specPath = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (argv[i][0] != '-' && !specPath) {
+            specPath = argv[i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (!specPath) {
+        usage();
+        return 2;
+    }
+
+    std::string text, error;
+    if (!readFile(specPath, text)) {
+        std::fprintf(stderr, "arc-render: can't read %s\n", specPath);
+        return 1;
+    }
+    Json spec;
+    std::vector<Job> jobs;
+    if (!Json::parse(text, spec, error) || !parseSpec(spec, dirName(specPath), jobs, error)) {
+        std::fprintf(stderr, "arc-render: %s: %s\n", specPath, error.c_str());
+        return 1;
+    }
+
+    // The same kernels the plugin would pick on this machine.
+    arc::dsp::selectKernels();
+
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, (int)jobs.size());
+
+    // Each worker takes the next job until there are none left, so long and
+    // short files balance out across the cores.
+    std::atomic<size_t> next{0};
+    std::atomic<int> failed{0};
+    std::mutex printMutex;
+
+    auto work = [&]() {
+        size_t j;
+        while ((j = next.fetch_add(1)) < jobs.size()) {
+            std::string jobError;
+            bool ok = runJob(jobs[j], jobError);
+
+            std::lock_guard<std::mutex> lock(printMutex);
+            if (ok) {
+                std::printf("%s\n", jobs[j].output.c_str());
+            } else {
+                std::fprintf(stderr, "arc-render: %s\n", jobError.c_str());
+                failed++;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.push_back(std::thread(work));
+    }
+    for (std::thread& t : pool) {
+        t.join();
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,505 @@
+#include "render.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "arc_atv.hpp"
+#include "arc_clip.hpp"
+#include "arc_fm.hpp"
+#include "arc_gain.hpp"
+#include "arc_kernels.hpp"
+#include "arc_strip.hpp"
+#include "arc_wav.hpp"
+#include "wav_file.hpp"
+
+namespace arc {
+namespace render {
+
+// Frames per block. Small enough that a block of every stage stays in cache.
+static const uint32_t kBlockFrames = 4096;
+
+// stdio buffer for each output, so the disk sees large sequential writes.
+static const size_t kFileBufferSize = 1 << 20;
+
+//--------------------------------------------------------------
+// WavWriter
+//--------------------------------------------------------------
+
+// Writes 32-bit float samples, scaled back from voltages the way Rack's Audio
+// module does, so nothing is lost to dither or clipping.
+class WavWriter {
+
+    std::FILE* file = NULL;
+    std::vector<char> fileBuffer;
+    std::vector<float> samples;
+
+    int sampleRate = 0;
+    int channels = 0;
+    uint32_t frames = 0;
+
+  public:
+
+    ~WavWriter() {
+        if (file) {
+            std::fclose(file);
+        }
+    }
+
+    bool open(const std::string& path, int sampleRate_, int channels_, std::string& error) {
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            error = "can't create " + path;
+            return false;
+        }
+        fileBuffer.resize(kFileBufferSize);
+        std::setvbuf(file, fileBuffer.data(), _IOFBF, fileBuffer.size());
+
+        sampleRate = sampleRate_;
+        channels = channels_;
+        arc::dsp::writeWavHeader(file, sampleRate, channels, 0);
+        return true;
+    }
+
+    void write(const float* voltages, uint32_t count) {
+        size_t n = (size_t)count * channels;
+        samples.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            samples[i] = voltages[i] / 10.0f;
+        }
+        std::fwrite(samples.data(), sizeof(float), n, file);
+        frames += count;
+    }
+
+    bool close(const std::string& path, std::string& error) {
+        arc::dsp::writeWavHeader(file, sampleRate, channels, frames);
+        bool ok = !std::ferror(file);
+        ok &= std::fclose(file) == 0;
+        file = NULL;
+        if (!ok) {
+            error = "can't write " + path;
+        }
+        return ok;
+    }
+};
+
+//--------------------------------------------------------------
+// chain
+//--------------------------------------------------------------
+
+// Delays interleaved audio by a whole number of frames, starting from 0V.
+class FrameDelay {
+
+    int frames = 0;
+    int channels = 0;
+
+    // The last `frames` frames, yet to be delivered, then room for a block
+    // to pass through.
+    std::vector<float> held;
+
+  public:
+
+    FrameDelay(int frames_, int channels_)
+        : frames(frames_),
+          channels(channels_),
+          held((frames_ + kBlockFrames) * channels_, 0.0f) {
+    }
+
+    void process(float* buffer, int n) {
+        if (frames == 0) {
+            return;
+        }
+        std::copy(buffer, buffer + n * channels, held.begin() + frames * channels);
+        std::copy(held.begin(), held.begin() + n * channels, buffer);
+        std::copy(
+            held.begin() + n * channels,
+            held.begin() + (n + frames) * channels,
+            held.begin());
+    }
+};
+
+// The engines for one stage. Only the one the stage names is used.
+struct StageEngines {
+    arc::dsp::GainEngine gain;
+    arc::dsp::ClipEngine clip;
+    arc::dsp::AttenuverterEngine atv;
+    arc::dsp::FmEngine fm;
+
+    // The cable into this stage, which delays the audio by a frame, as a
+    // Rack cable does.
+    FrameDelay cable;
+
+    // CLIP's block mode, which delays its output by a block.
+    FrameDelay clipBlock;
+
+    StageEngines(const Stage& stage, float sampleRate, int channels)
+        : cable(1, channels),
+          clipBlock((stage.module == Stage::kClip) ? stage.blockFrames : 0, channels) {
+        gain.onSampleRateChange(sampleRate);
+        gain.level = stage.level + stage.boost;
+        gain.muted = stage.muted;
+
+        clip.onSampleRateChange(sampleRate);
+        clip.level = stage.level;
+        clip.shape = stage.shape;
+
+        atv.amount = stage.amount;
+
+        fm.ratio = stage.ratio;
+        fm.offset = stage.offset;
+        fm.quantizeRatio = stage.quantizeRatio;
+    }
+
+    void process(Stage::Module module, float* buffer, int frames, int channels) {
+        // clang-format off
+        switch (module) {
+            case Stage::kGain: gain.processBlock(buffer, buffer, frames, channels); break;
+            case Stage::kClip: clip.processBlock(buffer, buffer, frames, channels); break;
+            case Stage::kAtv:  atv.processBlock(buffer, buffer, frames, channels);  break;
+            case Stage::kFm:   fm.processBlock(buffer, buffer, frames, channels);   break;
+        }
+        // clang-format on
+        clipBlock.process(buffer, frames);
+    }
+};
+
+static bool runChain(const Job& job, std::string& error) {
+
+    WavFile in;
+    if (!in.open(job.input, error)) {
+        return false;
+    }
+    int channels = in.getChannels();
+    if (channels > arc::dsp::kKernelWidth) {
+        error = job.input + ": more than 16 channels";
+        return false;
+    }
+
+    std::vector<StageEngines> engines;
+    engines.reserve(job.chain.size());
+    for (const Stage& stage : job.chain) {
+        engines.push_back(StageEngines(stage, in.getSampleRate(), channels));
+    }
+
+    WavWriter out;
+    if (!out.open(job.output, in.getSampleRate(), channels, error)) {
+        return false;
+    }
+
+    std::vector<float> buffer(kBlockFrames * channels);
+    for (uint32_t start = 0; start < in.getFrames(); start += kBlockFrames) {
+        uint32_t n = std::min(kBlockFrames, in.getFrames() - start);
+
+        // Each cable between two stages delays the audio by a frame, as it
+        // would in Rack.
+        in.read(start, n, buffer.data());
+        for (size_t s = 0; s < engines.size(); s++) {
+            if (s > 0) {
+                engines[s].cable.process(buffer.data(), n);
+            }
+            engines[s].process(job.chain[s].module, buffer.data(), n, channels);
+        }
+        out.write(buffer.data(), n);
+    }
+
+    return out.close(job.output, error);
+}
+
+//--------------------------------------------------------------
+// TRACK-4
+//--------------------------------------------------------------
+
+static void initStrip(arc::dsp::StripEngine& engine, const Strip& strip, float sampleRate) {
+    engine.onSampleRateChange(sampleRate);
+    engine.level = strip.level;
+    engine.pan = strip.pan;
+    engine.muted = strip.muted;
+    engine.saturate = strip.saturate;
+}
+
+// Mirrors TRACK4::process(): each patched track's sums become one channel of
+// the mix track's 4-channel input, and the mix track's sums are the output.
+static bool runTrack4(const Job& job, std::string& error) {
+
+    const int kTracks = Job::kTracks;
+
+    WavFile in[kTracks];
+    arc::dsp::StripEngine tracks[kTracks];
+    arc::dsp::StripEngine mix;
+
+    int sampleRate = 0;
+    uint32_t frames = 0;
+
+    for (int t = 0; t < kTracks; t++) {
+        const std::string& path = job.tracks[t].input;
+        if (path.empty()) {
+            continue;
+        }
+        if (!in[t].open(path, error)) {
+            return false;
+        }
+        if (in[t].getChannels() > 2) {
+            error = path + ": a track takes a mono or stereo file";
+            return false;
+        }
+        if (sampleRate && in[t].getSampleRate() != sampleRate) {
+            error = path + ": every track must have the same sample rate";
+            return false;
+        }
+        sampleRate = in[t].getSampleRate();
+        frames = std::max(frames, in[t].getFrames());
+        initStrip(tracks[t], job.tracks[t], sampleRate);
+    }
+    if (!sampleRate) {
+        error = "no tracks";
+        return false;
+    }
+    initStrip(mix, job.mix, sampleRate);
+
+    WavWriter out;
+    if (!out.open(job.output, sampleRate, 2, error)) {
+        return false;
+    }
+
+    std::vector<float> decoded(kBlockFrames * 2);
+    std::vector<float> inLeft(kBlockFrames), inRight(kBlockFrames);
+    std::vector<float> outLeft(kBlockFrames * kTracks), outRight(kBlockFrames * kTracks);
+    std::vector<float> sumLeft(kBlockFrames), sumRight(kBlockFrames);
+    std::vector<float> mixLeft(kBlockFrames * kTracks), mixRight(kBlockFrames * kTracks);
+    std::vector<float> result(kBlockFrames * 2);
+
+    for (uint32_t start = 0; start < frames; start += kBlockFrames) {
+        uint32_t n = std::min(kBlockFrames, frames - start);
+
+        for (int t = 0; t < kTracks; t++) {
+            if (job.tracks[t].input.empty()) {
+                // An unpatched track sums to 0V, and its engine doesn't run.
+                for (uint32_t f = 0; f < n; f++) {
+                    mixLeft[f * kTracks + t] = 0.0f;
+                    mixRight[f * kTracks + t] = 0.0f;
+                }
+                continue;
+            }
+
+            // A mono file plays into both sides.
+            int channels = in[t].getChannels();
+            in[t].read(start, n, decoded.data());
+            for (uint32_t f = 0; f < n; f++) {
+                inLeft[f] = decoded[f * channels];
+                inRight[f] = decoded[f * channels + channels - 1];
+            }
+
+            tracks[t].leftSums = sumLeft.data();
+            tracks[t].rightSums = sumRight.data();
+            tracks[t].processBlock(
+                inLeft.data(), inRight.data(), outLeft.data(), outRight.data(), n, 1);
+
+            for (uint32_t f = 0; f < n; f++) {
+                mixLeft[f * kTracks + t] = sumLeft[f];
+                mixRight[f * kTracks + t] = sumRight[f];
+            }
+        }
+
+        mix.leftSums = sumLeft.data();
+        mix.rightSums = sumRight.data();
+        mix.processBlock(
+            mixLeft.data(), mixRight.data(), outLeft.data(), outRight.data(), n, kTracks);
+
+        for (uint32_t f = 0; f < n; f++) {
+            result[f * 2] = sumLeft[f];
+            result[f * 2 + 1] = sumRight[f];
+        }
+        out.write(result.data(), n);
+    }
+
+    return out.close(job.output, error);
+}
+
+bool runJob(const Job& job, std::string& error) {
+    return job.track4 ? runTrack4(job, error) : runChain(job, error);
+}
+
+//--------------------------------------------------------------
+// spec
+//--------------------------------------------------------------
+
+static std::string resolve(const std::string& baseDir, const std::string& path) {
+    bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+    absolute |= path.size() > 1 && path[1] == ':';
+    if (absolute || baseDir.empty()) {
+        return path;
+    }
+    return baseDir + "/" + path;
+}
+
+static bool getNumber(const Json& obj, const char* key, float& out, std::string& error) {
+    const Json* v = obj.get(key);
+    if (!v) {
+        return true;
+    }
+    if (v->type != Json::kNumber) {
+        error = std::string("'") + key + "' must be a number";
+        return false;
+    }
+    out = (float)v->number;
+    return true;
+}
+
+static bool getBool(const Json& obj, const char* key, bool& out, std::string& error) {
+    const Json* v = obj.get(key);
+    if (!v) {
+        return true;
+    }
+    if (v->type != Json::kBool) {
+        error = std::string("'") + key + "' must be true or false";
+        return false;
+    }
+    out = v->boolean;
+    return true;
+}
+
+static bool getPath(
+    const Json& obj,
+    const char* key,
+    const std::string& baseDir,
+    std::string& out,
+    std::string& error) {
+    const Json* v = obj.get(key);
+    if (!v || v->type != Json::kString || v->string.empty()) {
+        error = std::string("'") + key + "' must be a path";
+        return false;
+    }
+    out = resolve(baseDir, v->string);
+    return true;
+}
+
+static bool parseStage(const Json& obj, Stage& stage, std::string& error) {
+    const Json* module = obj.get("module");
+    std::string name = (module && module->type == Json::kString) ? module->string : "";
+
+    if (name == "GAIN") {
+        stage.module = Stage::kGain;
+    } else if (name == "CLIP") {
+        stage.module = Stage::kClip;
+    } else if (name == "ATV") {
+        stage.module = Stage::kAtv;
+    } else if (name == "FM") {
+        stage.module = Stage::kFm;
+    } else {
+        error = "'module' must be GAIN, CLIP, ATV or FM";
+        return false;
+    }
+
+    const Json* shape = obj.get("shape");
+    if (shape) {
+        stage.shape = -1;
+        for (int s = 0; s < arc::dsp::kShapesLen; s++) {
+            if (shape->type == Json::kString && shape->string == arc::dsp::shapeName(s)) {
+                stage.shape = s;
+            }
+        }
+        if (stage.shape < 0) {
+            error = "unknown 'shape'";
+            return false;
+        }
+    }
+
+    float blockFrames = 0.0f;
+    if (!getNumber(obj, "blockFrames", blockFrames, error)) {
+        return false;
+    }
+    if (blockFrames < 0.0f || blockFrames > arc::dsp::ClipBlockBuffer::kMaxBlockFrames ||
+        blockFrames != (int)blockFrames) {
+        error = "'blockFrames' must be a whole number from 0 to 64";
+        return false;
+    }
+    stage.blockFrames = (int)blockFrames;
+
+    return getNumber(obj, "level", stage.level, error) &&
+           getNumber(obj, "boost", stage.boost, error) &&
+           getBool(obj, "muted", stage.muted, error) &&
+           getNumber(obj, "amount", stage.amount, error) &&
+           getNumber(obj, "ratio", stage.ratio, error) &&
+           getNumber(obj, "offset", stage.offset, error) &&
+           getBool(obj, "quantizeRatio", stage.quantizeRatio, error);
+}
+
+static bool parseStrip(
+    const Json& obj,
+    const std::string& baseDir,
+    bool hasInput,
+    Strip& strip,
+    std::string& error) {
+    if (hasInput && !getPath(obj, "input", baseDir, strip.input, error)) {
+        return false;
+    }
+    return getNumber(obj, "level", strip.level, error) &&
+           getNumber(obj, "pan", strip.pan, error) &&
+           getBool(obj, "muted", strip.muted, error) &&
+           getBool(obj, "saturate", strip.saturate, error);
+}
+
+static bool parseJob(const Json& obj, const std::string& baseDir, Job& job, std::string& error) {
+    if (obj.type != Json::kObject) {
+        error = "a job must be an object";
+        return false;
+    }
+    if (!getPath(obj, "output", baseDir, job.output, error)) {
+        return false;
+    }
+
+    const Json* tracks = obj.get("tracks");
+    if (tracks) {
+        job.track4 = true;
+        if (tracks->type != Json::kArray || tracks->items.size() > Job::kTracks) {
+            error = "'tracks' must be an array of up to 4 tracks";
+            return false;
+        }
+        for (size_t t = 0; t < tracks->items.size(); t++) {
+            const Json& track = tracks->items[t];
+            if (track.type == Json::kNull) {
+                continue;
+            }
+            if (!parseStrip(track, baseDir, true, job.tracks[t], error)) {
+                return false;
+            }
+        }
+        const Json* mix = obj.get("mix");
+        return !mix || parseStrip(*mix, baseDir, false, job.mix, error);
+    }
+
+    if (!getPath(obj, "input", baseDir, job.input, error)) {
+        return false;
+    }
+    const Json* chain = obj.get("chain");
+    if (!chain || chain->type != Json::kArray) {
+        error = "a job needs either 'chain' or 'tracks'";
+        return false;
+    }
+    for (const Json& s : chain->items) {
+        job.chain.push_back(Stage());
+        if (!parseStage(s, job.chain.back(), error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parseSpec(
+    const Json& spec, const std::string& baseDir, std::vector<Job>& jobs, std::string& error) {
+    const Json* list = spec.get("jobs");
+    if (!list || list->type != Json::kArray) {
+        error = "the spec needs a 'jobs' array";
+        return false;
+    }
+    for (size_t j = 0; j < list->items.size(); j++) {
+        jobs.push_back(Job());
+        if (!parseJob(list->items[j], baseDir, jobs.back(), error)) {
+            error = "job " + std::to_string(j + 1) + ": " + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace render
+} // namespace arc
@@ -0,0 +1,83 @@
+#pragma once
+
+// Offline rendering of WAV stems through the same engines the modules run
+// live. See docs/render.md for the spec format.
+//
+// Each job builds fresh engines, exactly as if the modules had just been
+// added to a patch at the file's sample rate, and feeds them the file with
+// every CV input unpatched. So a render is bit-identical to what the modules
+// produce live with the same settings, including the 5ms fade-in every level
+// starts with.
+
+#include <string>
+#include <vector>
+
+#include "arc_shapers.hpp"
+#include "json.hpp"
+
+namespace arc {
+namespace render {
+
+// One module in a chain. Each field is in the module's own units, and
+// defaults to the module's default.
+struct Stage {
+
+    enum Module { kGain, kClip, kAtv, kFm };
+
+    Module module = kGain;
+
+    // GAIN and CLIP, in dB. GAIN adds level and boost, like its knobs.
+    float level = 0.0f;
+    float boost = 0.0f;
+    bool muted = false;
+
+    // CLIP. In block mode, its output is delayed by blockFrames, up to 64.
+    int shape = arc::dsp::kCubic;
+    int blockFrames = 0;
+
+    // ATV
+    float amount = 0.0f;
+
+    // FM. The offset is in knob units of 40 Hz each.
+    float ratio = 1.0f;
+    float offset = 0.0f;
+    bool quantizeRatio = true;
+};
+
+// One stereo strip of a TRACK-4.
+struct Strip {
+    std::string input; // empty if unpatched
+    float level = 0.0f; // in dB
+    float pan = 0.0f;
+    bool muted = false;
+    bool saturate = false;
+};
+
+struct Job {
+
+    static const int kTracks = 4;
+
+    std::string output;
+
+    // A chain job runs each channel of the input through the stages in
+    // order, as one polyphonic cable.
+    std::string input;
+    std::vector<Stage> chain;
+
+    // A TRACK-4 job mixes up to four mono or stereo inputs, and writes the
+    // stereo mix output.
+    bool track4 = false;
+    Strip tracks[kTracks];
+    Strip mix;
+};
+
+// Reads the jobs from a spec. Relative paths are resolved against baseDir.
+bool parseSpec(
+    const Json& spec, const std::string& baseDir, std::vector<Job>& jobs, std::string& error);
+
+// Runs one job, start to finish. Safe to call for different jobs from
+// several threads at once.
+bool runJob(const Job& job, std::string& error);
+
+} // namespace render
+} // namespace arc
@@ -0,0 +1,208 @@
+#include "wav_file.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace arc {
+namespace render {
+
+static const int kFormatPcm = 1;
+static const int kFormatFloat = 3;
+static const int kFormatExtensible = 0xFFFE;
+
+static uint32_t getU16(const unsigned char* p) {
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t getU32(const unsigned char* p) {
+    return getU16(p) | getU16(p + 2) << 16;
+}
+
+WavFile::~WavFile() {
+    close();
+}
+
+void WavFile::close() {
+#ifndef _WIN32
+    if (map && contents.empty()) {
+        munmap((void*)map, mapSize);
+    }
+#endif
+    map = NULL;
+    mapSize = 0;
+    contents.clear();
+    samples = NULL;
+}
+
+bool WavFile::open(const std::string& path, std::string& error) {
+    close();
+
+#ifdef _WIN32
+    // No mmap: read the whole file instead.
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "can't open " + path;
+        return false;
+    }
+    std::fseek(file, 0, SEEK_END);
+    contents.resize(std::ftell(file));
+    std::fseek(file, 0, SEEK_SET);
+    size_t n = std::fread(contents.data(), 1, contents.size(), file);
+    std::fclose(file);
+    if (n != contents.size()) {
+        error = "can't read " + path;
+        return false;
+    }
+    map = contents.data();
+    mapSize = contents.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "can't open " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        error = "can't read " + path;
+        return false;
+    }
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        error = "can't map " + path;
+        return false;
+    }
+    // Rendering reads each stem front to back, once.
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+    map = (const unsigned char*)p;
+    mapSize = st.st_size;
+#endif
+
+    if (!parse(error)) {
+        error = path + ": " + error;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool WavFile::parse(std::string& error) {
+    bool riff = mapSize >= 12 && std::memcmp(map, "RIFF", 4) == 0;
+    if (!riff || std::memcmp(map + 8, "WAVE", 4) != 0) {
+        error = "not a WAV file";
+        return false;
+    }
+
+    int format = 0;
+    const unsigned char* data = NULL;
+    uint32_t dataSize = 0;
+
+    // Walk the chunks. Odd-sized chunks are padded to an even size.
+    size_t pos = 12;
+    while (pos + 8 <= mapSize) {
+        const unsigned char* chunk = map + pos;
+        uint32_t size = getU32(chunk + 4);
+        size_t avail = mapSize - pos - 8;
+
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16 && size <= avail) {
+            format = getU16(chunk + 8);
+            channels = getU16(chunk + 10);
+            sampleRate = getU32(chunk + 12);
+            bits = getU16(chunk + 22);
+            if (format == kFormatExtensible && size >= 40) {
+                // The first two bytes of the subformat GUID are the format.
+                format = getU16(chunk + 32);
+            }
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            // Some writers leave the size at 0 or -1 for a stream; trust the
+            // file length instead.
+            data = chunk + 8;
+            dataSize = (size == 0 || size > avail) ? avail : size;
+            break;
+        }
+        pos += 8 + (size_t)size + (size & 1);
+    }
+
+    if (!format) {
+        error = "no fmt chunk";
+        return false;
+    }
+    if (!data) {
+        error = "no data chunk";
+        return false;
+    }
+
+    if (format == kFormatPcm && (bits == 16 || bits == 24 || bits == 32)) {
+        encoding = kPcm;
+    } else if (format == kFormatFloat && (bits == 32 || bits == 64)) {
+        encoding = kFloat;
+    } else {
+        error = "unsupported sample format";
+        return false;
+    }
+    if (channels < 1 || sampleRate < 1) {
+        error = "bad fmt chunk";
+        return false;
+    }
+
+    samples = data;
+    frames = dataSize / (channels * (bits / 8));
+    return true;
+}
+
+float WavFile::decode(const unsigned char* p) const {
+    if (encoding == kFloat) {
+        if (bits == 32) {
+            uint32_t u = getU32(p);
+            float f;
+            std::memcpy(&f, &u, sizeof(f));
+            return f;
+        }
+        uint64_t u = getU32(p) | (uint64_t)getU32(p + 4) << 32;
+        double d;
+        std::memcpy(&d, &u, sizeof(d));
+        return (float)d;
+    }
+
+    if (bits == 24) {
+        // Shift into the top of an int32, to sign extend.
+        int32_t v = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24);
+        return (v >> 8) / 8388608.0f;
+    }
+    if (bits == 16) {
+        return (int16_t)getU16(p) / 32768.0f;
+    }
+    return (int32_t)getU32(p) / 2147483648.0f;
+}
+
+void WavFile::read(uint32_t start, uint32_t count, float* out) const {
+    int bytes = bits / 8;
+
+    for (uint32_t f = 0; f < count; f++) {
+        float* frame = out + (size_t)f * channels;
+        uint32_t src = start + f;
+
+        if (src >= frames) {
+            for (int ch = 0; ch < channels; ch++) {
+                frame[ch] = 0.0f;
+            }
+            continue;
+        }
+
+        const unsigned char* p = samples + (size_t)src * channels * bytes;
+        for (int ch = 0; ch < channels; ch++) {
+            frame[ch] = decode(p + ch * bytes) * 10.0f;
+        }
+    }
+}
+
+} // namespace render
+} // namespace arc
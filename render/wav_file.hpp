@@ -0,0 +1,71 @@
+#pragma once
+
+// A read-only, memory-mapped WAV file. Samples are decoded straight out of
+// the mapping, a block at a time, so a batch of long stems never has to fit
+// in memory at once.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace arc {
+namespace render {
+
+class WavFile {
+
+  public:
+
+    WavFile() {
+    }
+
+    ~WavFile();
+
+    WavFile(const WavFile&) = delete;
+    WavFile& operator=(const WavFile&) = delete;
+
+    // Maps the file and reads its header. Handles 16, 24 and 32-bit PCM and
+    // 32 and 64-bit float, plain or WAVE_FORMAT_EXTENSIBLE.
+    bool open(const std::string& path, std::string& error);
+
+    int getChannels() const {
+        return channels;
+    }
+
+    int getSampleRate() const {
+        return sampleRate;
+    }
+
+    uint32_t getFrames() const {
+        return frames;
+    }
+
+    // Decodes `count` frames from `start` into interleaved voltages, scaled
+    // the way Rack's Audio module does: full scale is 10V. Frames past the
+    // end of the file read as 0V.
+    void read(uint32_t start, uint32_t count, float* out) const;
+
+  private:
+
+    enum Encoding { kPcm, kFloat };
+
+    const unsigned char* map = NULL;
+    size_t mapSize = 0;
+
+    // Only used where memory mapping isn't available.
+    std::vector<unsigned char> contents;
+
+    const unsigned char* samples = NULL;
+    Encoding encoding = kPcm;
+    int bits = 0;
+    int channels = 0;
+    int sampleRate = 0;
+    uint32_t frames = 0;
+
+    bool parse(std::string& error);
+    void close();
+
+    float decode(const unsigned char* p) const;
+};
+
+} // namespace render
+} // namespace arc
@@ -0,0 +1,490 @@
+#!/usr/bin/env python3
+
+# Shrinks the SVGs that Inkscape writes into res/, so that Rack parses and
+# draws less when a patch opens. render.py runs this on everything it
+# renders; it can also be run by hand on any SVG files:
+#
+#   scripts/optimize.py res/*.svg
+#
+# It drops everything nanosvg ignores (metadata, editor state, the CSS header,
+# symbols and gradients nothing refers to, text styling on text that Inkscape
+# has already turned into paths), collapses groups, rewrites path data as
+# absolute coordinates to 3 decimals, and merges runs of sibling paths that
+# share a style into one path, so each label becomes a single shape.
+#
+# Before writing, it flattens the old and new documents into the list of
+# primitives Rack would draw, in order, with their effective style and
+# transform, and refuses to write the file unless the two lists match.
+
+import math
+import re
+import sys
+import xml.etree.ElementTree as ET
+
+SVG = 'http://www.w3.org/2000/svg'
+XLINK = 'http://www.w3.org/1999/xlink'
+
+ET.register_namespace('', SVG)
+ET.register_namespace('xlink', XLINK)
+
+# Containers whose children are never drawn directly.
+NOT_DRAWN = {'defs', 'symbol', 'clipPath', 'mask', 'pattern', 'marker',
+             'linearGradient', 'radialGradient', 'style', 'metadata',
+             'title', 'desc', 'namedview', 'RDF'}
+
+# The only properties that affect how nanosvg draws a shape.
+PAINT = ['fill', 'fill-opacity', 'fill-rule', 'stroke', 'stroke-width',
+         'stroke-opacity', 'stroke-linecap', 'stroke-linejoin',
+         'stroke-miterlimit', 'stroke-dasharray', 'stroke-dashoffset',
+         'opacity', 'display', 'visibility']
+
+# Editor and text properties, which mean nothing once text is paths.
+DROPPED_STYLE = re.compile(
+    r'^(-inkscape-.*|font(-.*)?|text-(anchor|align)|line-height|'
+    r'letter-spacing|word-spacing|writing-mode)$')
+
+# How far a merged path's coordinates may move, in px.
+PRECISION = 3
+TOLERANCE = 1.5 * 10 ** -PRECISION
+
+#------------------------------------
+# elements
+
+def local(name):
+    return name.rsplit('}', 1)[-1]
+
+def namespace(name):
+    return name[1:].split('}')[0] if name.startswith('{') else ''
+
+def parse_style(style):
+    props = {}
+    for decl in (style or '').split(';'):
+        if ':' in decl:
+            key, value = decl.split(':', 1)
+            props[key.strip()] = value.strip()
+    return props
+
+def format_style(props):
+    return ';'.join(k + ':' + v for k, v in props.items())
+
+# Presentation attributes, overridden by the style attribute.
+def own_paint(e):
+    props = {}
+    for key in PAINT:
+        if key in e.attrib:
+            props[key] = e.attrib[key]
+    props.update({k: v for k, v in parse_style(e.get('style')).items() if k in PAINT})
+    return props
+
+def references(root):
+    refs = set()
+    for e in root.iter():
+        for key, value in e.attrib.items():
+            refs.update(re.findall(r"url\(\s*['\"]?#([^'\")\s]+)", value))
+            if local(key) == 'href' and value.startswith('#'):
+                refs.add(value[1:])
+    return refs
+
+#------------------------------------
+# path data
+
+COMMAND = re.compile(r'[MmLlHhVvCcSsQqTtAaZz]')
+NUMBER = re.compile(r'[-+]?(?:\d+\.?\d*|\.\d+)(?:[eE][-+]?\d+)?')
+SEPARATOR = re.compile(r'[\s,]*')
+ARITY = {'M': 2, 'L': 2, 'H': 1, 'V': 1, 'C': 6, 'S': 4, 'Q': 4, 'T': 2, 'A': 7, 'Z': 0}
+
+# Parses path data into (command, args) with every coordinate absolute.
+def parse_path(d):
+    segments = []
+    pos = 0
+    x = y = 0.0
+    start = (0.0, 0.0)
+    command = None
+
+    def number():
+        nonlocal pos
+        pos = SEPARATOR.match(d, pos).end()
+        m = NUMBER.match(d, pos)
+        if not m:
+            raise ValueError('bad path data near ' + repr(d[pos:pos + 20]))
+        pos = m.end()
+        return float(m.group())
+
+    def flag():
+        nonlocal pos
+        pos = SEPARATOR.match(d, pos).end()
+        if d[pos:pos + 1] not in ('0', '1'):
+            raise ValueError('bad arc flag near ' + repr(d[pos:pos + 20]))
+        pos += 1
+        return float(d[pos - 1])
+
+    while True:
+        pos = SEPARATOR.match(d, pos).end()
+        if pos >= len(d):
+            break
+        m = COMMAND.match(d, pos)
+        if m:
+            command = m.group()
+            pos = m.end()
+        elif command is None or command in 'Zz':
+            raise ValueError('bad path data near ' + repr(d[pos:pos + 20]))
+
+        upper = command.upper()
+        relative = command != upper
+
+        if upper == 'Z':
+            segments.append(('Z', []))
+            x, y = start
+            continue
+
+        if upper == 'A':
+            args = [number(), number(), number(), flag(), flag(), number(), number()]
+        else:
+            args = [number() for _ in range(ARITY[upper])]
+
+        if relative:
+            if upper == 'H':
+                args[0] += x
+            elif upper == 'V':
+                args[0] += y
+            elif upper == 'A':
+                args[5] += x
+                args[6] += y
+            else:
+                for i in range(0, len(args), 2):
+                    args[i] += x
+                    args[i + 1] += y
+
+        if upper == 'H':
+            x = args[0]
+        elif upper == 'V':
+            y = args[0]
+        else:
+            x, y = args[-2], args[-1]
+
+        segments.append((upper, args))
+
+        # Further pairs after a moveto are linetos.
+        if upper == 'M':
+            start = (x, y)
+            command = 'l' if relative else 'L'
+
+    return segments
+
+def format_number(v):
+    s = ('%.*f' % (PRECISION, v)).rstrip('0').rstrip('.')
+    if s in ('-0', ''):
+        s = '0'
+    if s.startswith('0.'):
+        s = s[1:]
+    elif s.startswith('-0.'):
+        s = '-' + s[2:]
+    return s
+
+def format_path(segments):
+    out = ''
+    for command, args in segments:
+        out += command
+        for i, v in enumerate(args):
+            s = format_number(v)
+            # A separator is only needed where the next number could run on.
+            if i > 0 and not s.startswith('-') and not (s.startswith('.') and '.' in prev):
+                out += ' '
+            out += s
+            prev = s
+    return out
+
+def subpaths(segments):
+    result = []
+    for segment in segments:
+        if segment[0] == 'M' or not result:
+            result.append([])
+        result[-1].append(segment)
+    return result
+
+# A box that holds the path: every control point, plus a margin around arcs.
+def bounds(segments, margin):
+    xs = []
+    ys = []
+    x = y = 0.0
+    for command, args in segments:
+        if command == 'H':
+            x = args[0]
+        elif command == 'V':
+            y = args[0]
+        elif command == 'A':
+            r = 2 * max(abs(args[0]), abs(args[1]))
+            xs += [x - r, x + r, args[5] - r, args[5] + r]
+            ys += [y - r, y + r, args[6] - r, args[6] + r]
+            x, y = args[5], args[6]
+        elif args:
+            xs += args[0::2]
+            ys += args[1::2]
+            x, y = args[-2], args[-1]
+        xs.append(x)
+        ys.append(y)
+    return (min(xs) - margin, min(ys) - margin, max(xs) + margin, max(ys) + margin)
+
+def overlaps(a, b):
+    return a[0] < b[2] and b[0] < a[2] and a[1] < b[3] and b[1] < a[3]
+
+#------------------------------------
+# transforms
+
+def multiply(a, b):
+    return (a[0] * b[0] + a[2] * b[1], a[1] * b[0] + a[3] * b[1],
+            a[0] * b[2] + a[2] * b[3], a[1] * b[2] + a[3] * b[3],
+            a[0] * b[4] + a[2] * b[5] + a[4], a[1] * b[4] + a[3] * b[5] + a[5])
+
+IDENTITY = (1.0, 0.0, 0.0, 1.0, 0.0, 0.0)
+
+def parse_transform(text):
+    m = IDENTITY
+    for name, args in re.findall(r'(\w+)\s*\(([^)]*)\)', text or ''):
+        v = [float(n) for n in NUMBER.findall(args)]
+        if name == 'matrix':
+            t = tuple(v)
+        elif name == 'translate':
+            t = (1, 0, 0, 1, v[0], v[1] if len(v) > 1 else 0)
+        elif name == 'scale':
+            t = (v[0], 0, 0, v[1] if len(v) > 1 else v[0], 0, 0)
+        elif name == 'rotate':
+            a = math.radians(v[0])
+            t = (math.cos(a), math.sin(a), -math.sin(a), math.cos(a), 0, 0)
+            if len(v) == 3:
+                t = multiply((1, 0, 0, 1, v[1], v[2]), multiply(t, (1, 0, 0, 1, -v[1], -v[2])))
+        elif name == 'skewX':
+            t = (1, 0, math.tan(math.radians(v[0])), 1, 0, 0)
+        elif name == 'skewY':
+            t = (1, math.tan(math.radians(v[0])), 0, 1, 0, 0)
+        else:
+            raise ValueError('unknown transform ' + name)
+        m = multiply(m, t)
+    return m
+
+#------------------------------------
+# what gets drawn
+
+# Every primitive that would be drawn, in order: its effective paint, its
+# total transform, and its geometry. Paths count once per subpath, so that
+# merging paths doesn't change the list.
+def draw_list(root):
+    result = []
+
+    def walk(e, paint, matrix):
+        name = local(e.tag)
+        if name in NOT_DRAWN or namespace(e.tag) not in ('', SVG):
+            return
+        paint = dict(paint)
+        paint.update(own_paint(e))
+        matrix = multiply(matrix, parse_transform(e.get('transform')))
+        key = (tuple(sorted(paint.items())), matrix)
+
+        if name == 'path':
+            for sub in subpaths(parse_path(e.get('d', ''))):
+                result.append((key, 'path', sub))
+        elif name in ('svg', 'g'):
+            for child in e:
+                walk(child, paint, matrix)
+        else:
+            attrs = {k: v for k, v in e.attrib.items()
+                     if k not in PAINT and k not in ('style', 'id', 'class', 'transform')
+                     and namespace(k) in ('', XLINK)}
+            result.append((key, name, (sorted(attrs.items()), (e.text or '').strip())))
+
+    walk(root, {}, IDENTITY)
+    return result
+
+def same_draw_list(a, b):
+    if len(a) != len(b):
+        return False
+    for (keyA, kindA, geomA), (keyB, kindB, geomB) in zip(a, b):
+        if keyA[0] != keyB[0] or kindA != kindB:
+            return False
+        if any(abs(p - q) > 1e-9 for p, q in zip(keyA[1], keyB[1])):
+            return False
+        if kindA != 'path':
+            if geomA != geomB:
+                return False
+            continue
+        if len(geomA) != len(geomB):
+            return False
+        for (cA, argsA), (cB, argsB) in zip(geomA, geomB):
+            if cA != cB or any(abs(p - q) > TOLERANCE for p, q in zip(argsA, argsB)):
+                return False
+    return True
+
+#------------------------------------
+# passes
+
+def drop_editor_state(root):
+    for parent in list(root.iter()):
+        for child in list(parent):
+            if not isinstance(child.tag, str):
+                parent.remove(child)    # comments
+            elif namespace(child.tag) not in ('', SVG):
+                parent.remove(child)    # sodipodi:namedview and friends
+            elif local(child.tag) in ('metadata', 'style', 'title', 'desc'):
+                parent.remove(child)
+    for e in root.iter():
+        for key in list(e.attrib):
+            if namespace(key) not in ('', XLINK) or key in ('class', 'aria-label'):
+                del e.attrib[key]
+
+def drop_unused_defs(root):
+    # Dropping one def can orphan another, such as a gradient's template.
+    while True:
+        refs = references(root)
+        dropped = False
+        for defs in root.iter('{%s}defs' % SVG):
+            for child in list(defs):
+                if child.get('id') not in refs:
+                    defs.remove(child)
+                    dropped = True
+        if not dropped:
+            break
+    for parent in list(root.iter()):
+        for child in list(parent):
+            if local(child.tag) == 'defs' and len(child) == 0:
+                parent.remove(child)
+    refs = references(root)
+    for e in root.iter():
+        if 'id' in e.attrib and e.get('id') not in refs:
+            del e.attrib['id']
+
+def clean_styles(root):
+    for e in root.iter():
+        if 'style' in e.attrib:
+            props = {k: v for k, v in parse_style(e.get('style')).items()
+                     if not DROPPED_STYLE.match(k)}
+            if props:
+                e.set('style', format_style(props))
+            else:
+                del e.attrib['style']
+
+def collapse_groups(root):
+    while collapse_group(root):
+        pass
+
+# Collapses one group, if any can be, and returns whether it did.
+def collapse_group(root):
+    for parent in root.iter():
+        for child in parent:
+            if local(child.tag) != 'g' or 'id' in child.attrib:
+                continue
+            attrs = set(child.attrib)
+            if not child:
+                parent.remove(child)
+            elif not attrs:
+                # a bare group: its children take its place
+                index = list(parent).index(child)
+                parent.remove(child)
+                for j, grandchild in enumerate(list(child)):
+                    parent.insert(index + j, grandchild)
+            elif attrs == {'transform'} and len(child) == 1:
+                # a transform around one element moves onto the element
+                only = child[0]
+                transform = child.get('transform')
+                if only.get('transform'):
+                    transform += ' ' + only.get('transform')
+                only.set('transform', transform)
+                index = list(parent).index(child)
+                parent.remove(child)
+                parent.insert(index, only)
+            else:
+                continue
+            return True
+    return False
+
+def rewrite_paths(root):
+    for e in root.iter('{%s}path' % SVG):
+        e.set('d', format_path(parse_path(e.get('d', ''))))
+
+# Paths can merge if they look the same, nothing about their paint depends
+# on their bounding box, and no two of them overlap, so neither winding
+# rules nor translucency can tell the difference.
+def merge_paths(root):
+
+    def mergeable(e, paint):
+        if local(e.tag) != 'path' or 'id' in e.attrib:
+            return False
+        values = ' '.join(paint.values())
+        for key in ('opacity', 'fill-opacity', 'stroke-opacity'):
+            if key in paint and float(paint[key]) < 1.0:
+                return False
+        return 'url(' not in values
+
+    def walk(parent, paint):
+        paint = dict(paint)
+        paint.update(own_paint(parent))
+
+        children = list(parent)
+        run = []
+
+        def flush():
+            if len(run) > 1:
+                segments = []
+                for e in run:
+                    segments += parse_path(e.get('d'))
+                run[0].set('d', format_path(segments))
+                for e in run[1:]:
+                    parent.remove(e)
+            run.clear()
+
+        boxes = []
+        for child in children:
+            childPaint = dict(paint)
+            childPaint.update(own_paint(child))
+            if not mergeable(child, childPaint):
+                flush()
+                boxes = []
+                walk(child, paint)
+                continue
+
+            width = float(NUMBER.match(childPaint.get('stroke-width', '1')).group())
+            stroked = childPaint.get('stroke', 'none') != 'none'
+            box = bounds(parse_path(child.get('d')), width * 2 if stroked else 0.0)
+
+            attrs = {k: v for k, v in child.attrib.items() if k != 'd'}
+            first = {k: v for k, v in run[0].attrib.items() if k != 'd'} if run else None
+            if run and (attrs != first or any(overlaps(box, b) for b in boxes)):
+                flush()
+                boxes = []
+            run.append(child)
+            boxes.append(box)
+        flush()
+
+    walk(root, {})
+
+#------------------------------------
+
+def optimize(path):
+    tree = ET.parse(path)
+    root = tree.getroot()
+    before = draw_list(root)
+    size = len(open(path, 'rb').read())
+
+    drop_editor_state(root)
+    drop_unused_defs(root)
+    clean_styles(root)
+    collapse_groups(root)
+    rewrite_paths(root)
+    merge_paths(root)
+
+    if not same_draw_list(before, draw_list(root)):
+        print(path + ': optimizing would change the drawing; left as is')
+        return False
+
+    ET.indent(tree, space=' ')
+    tree.write(path, encoding='UTF-8', xml_declaration=True)
+    open(path, 'a').write('\n')
+
+    after = len(open(path, 'rb').read())
+    print('%s: %d -> %d bytes' % (path, size, after))
+    return True
+
+if __name__ == '__main__':
+    ok = True
+    for path in sys.argv[1:]:
+        ok = optimize(path) and ok
+    sys.exit(0 if ok else 1)
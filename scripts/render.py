@@ -4,6 +4,8 @@ import glob
 import os
 import subprocess
 
+import optimize
+
 files = glob.glob('res-src/*-src.svg')
 
 for fin in files:
@@ -34,4 +36,7 @@ for fin in files:
             fout],
             check=True)
 
+        # Strip what Inkscape leaves behind and merge the glyph paths
+        optimize.optimize(fout)
+
 print('SVG rendering is done.')
@@ -1,3 +1,5 @@
+#include "arc_atv.hpp"
+#include "governor.hpp"
 #include "plugin.hpp"
 #include "widgets.hpp"
 
@@ -5,6 +7,9 @@
 
 struct ATV : Module {
 
+    arc::dsp::AttenuverterEngine atvs[2];
+    GovernorFeed governorFeed;
+
     enum ParamId {
         kCvParamA,
         kCvParamB,
@@ -52,27 +57,24 @@ struct ATV : Module {
 #endif
     }
 
-    void applyCV(int inputID, int paramID, int outputID) {
+    void applyCV(arc::dsp::AttenuverterEngine& atv, int inputID, int paramID, int outputID) {
 
         if (!outputs[outputID].isConnected()) {
             return;
         }
 
-        float pv = params[paramID].getValue();
+        atv.amount = params[paramID].getValue();
 
         int channels = std::max(inputs[inputID].getChannels(), 1);
-        for (int ch = 0; ch < channels; ch++) {
-
-            float in = inputs[inputID].getPolyVoltage(ch);
-            outputs[outputID].setVoltage(in * pv, ch);
-        }
+        atv.processBlock(inputs[inputID].voltages, outputs[outputID].voltages, 1, channels);
 
         outputs[outputID].setChannels(channels);
     }
 
     void process(const ProcessArgs& args) override {
-        applyCV(kInputA, kCvParamA, kOutputA);
-        applyCV(kInputB, kCvParamB, kOutputB);
+        governorFeed.step();
+        applyCV(atvs[0], kInputA, kCvParamA, kOutputA);
+        applyCV(atvs[1], kInputB, kCvParamB, kOutputB);
     }
 };
 
@@ -98,6 +100,13 @@ struct ATVWidget : ModuleWidget {
         addInput(createInputCentered<ArcPolyPort>(Vec(15, 224), module, ATV::kInputB));
         addParam(createParamCentered<ArcKnob18>(Vec(15, 266), module, ATV::kCvParamB));
         addOutput(createOutputCentered<ArcPolyPort>(Vec(15, 308), module, ATV::kOutputB));
+
+        addChild(createQualityBadgeCentered(Vec(15, 340), module));
+    }
+
+    void appendContextMenu(Menu* menu) override {
+        menu->addChild(new MenuSeparator);
+        appendQualityMenu(menu);
     }
 };
 
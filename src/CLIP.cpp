@@ -1,6 +1,5 @@
-#include <vector>
-
-#include "arc_dsp.hpp"
+#include "arc_clip.hpp"
+#include "governor.hpp"
 #include "plugin.hpp"
 #include "track.hpp"
 #include "widgets.hpp"
@@ -13,11 +12,17 @@
 
 struct CLIP : Module {
 
-    arc::dsp::Amplifier levelAmp;
-    arc::dsp::Amplifier levelCvAmps[engine::PORT_MAX_CHANNELS];
+    arc::dsp::ClipEngine clip;
+    arc::dsp::ClipBlockBuffer blocks;
+    PolyCv levelCv;
+    GovernorFeed governorFeed;
+
+    // The waveshaper curve, an arc::dsp::Shape.
+    int shape = arc::dsp::kCubic;
 
-    static const int kOversampleFactor = 4;
-    std::vector<arc::dsp::Oversample> oversample;
+    // Frames per block in block mode, which is also the latency, or 0 to
+    // process each frame as it arrives. The audio thread applies it.
+    int blockFrames = 0;
 
     enum ParamId { kLevelParam, kParamsLen };
 
@@ -44,68 +49,120 @@ struct CLIP : Module {
         configInput(kInput, "Audio");
         configOutput(kOutput, "Audio");
 
-        configBypass(kInput, kOutput);
-
 #ifdef CLIP_DEBUG
         configOutput(kDebug1, "Debug 1");
         configOutput(kDebug2, "Debug 2");
         configOutput(kDebug3, "Debug 3");
         configOutput(kDebug4, "Debug 4");
 #endif
-
-        for (int ch = 0; ch < engine::PORT_MAX_CHANNELS; ch++) {
-            oversample.push_back(arc::dsp::Oversample(kOversampleFactor));
-        }
     }
 
     void onSampleRateChange(const SampleRateChangeEvent& e) override {
-
-        levelAmp.onSampleRateChange(e.sampleRate);
-        for (int ch = 0; ch < engine::PORT_MAX_CHANNELS; ch++) {
-            levelCvAmps[ch].onSampleRateChange(e.sampleRate);
-            oversample[ch].onSampleRateChange(e.sampleRate);
-        }
+        clip.onSampleRateChange(e.sampleRate);
     }
 
-    float nextLevelCvAmp(int ch) {
-        float v = inputs[kLevelCvInput].getPolyVoltage(ch);
-        float db = rescale(v, 0.0f, 10.0f, kMinDb, kMaxDb);
-        return levelCvAmps[ch].next(db);
+    json_t* dataToJson() override {
+        json_t* root = json_object();
+        json_object_set_new(root, "shape", json_integer(shape));
+        json_object_set_new(root, "blockFrames", json_integer(blockFrames));
+        return root;
     }
 
-    float processChannel(int ch, float in, float limit) {
+    void dataFromJson(json_t* root) override {
+        json_t* shapeJ = json_object_get(root, "shape");
+        if (shapeJ) {
+            setShape(json_integer_value(shapeJ));
+        }
+
+        json_t* blockFramesJ = json_object_get(root, "blockFrames");
+        if (blockFramesJ) {
+            setBlockFrames(json_integer_value(blockFramesJ));
+        }
+    }
 
-        float buffer[arc::dsp::kMaxOversample] = {};
-        oversample[ch].upsample(in, buffer);
+    void setShape(int s) {
+        if (s < 0 || s >= arc::dsp::kShapesLen) {
+            s = arc::dsp::kCubic;
+        }
+        shape = s;
+    }
 
-        for (int i = 0; i < kOversampleFactor; i++) {
-            buffer[i] = arc::dsp::softClip(buffer[i] / limit) * limit;
+    // The latency is shown in the output's description, and on the panel.
+    void setBlockFrames(int frames) {
+        if (frames < 0 || frames > arc::dsp::ClipBlockBuffer::kMaxBlockFrames) {
+            frames = 0;
         }
+        blockFrames = frames;
 
-        return oversample[ch].downsample(buffer);
+        if (blockFrames == 0) {
+            outputInfos[kOutput]->description = "";
+        } else {
+            outputInfos[kOutput]->description =
+                string::f("Delayed by %d samples in block mode, bypassed or not.", blockFrames);
+        }
     }
 
     void process(const ProcessArgs& args) override {
+        governorFeed.step();
+
         if (!outputs[kOutput].isConnected()) {
+            // Otherwise a replug would play out what was queued before the
+            // unplug.
+            blocks.reset();
             return;
         }
 
-        float db = levelToDb(params[kLevelParam].getValue());
-        float amp = levelAmp.next(db);
+        int channels = std::max(inputs[kInput].getChannels(), 1);
+
+        int tier = governor().getTier();
+        clip.setOversample(arc::dsp::clipOversample(tier));
+        clip.coarse = arc::dsp::coarseTables(tier);
+
+        int cvDivision = arc::dsp::cvDivision(tier);
+        const float* cv = levelCv.gather(inputs[kLevelCvInput], channels, cvDivision);
+        clip.level = levelToDb(params[kLevelParam].getValue());
+        clip.shape = shape;
+
+        blocks.setBlockFrames(blockFrames);
+        outputs[kOutput].setChannels(blocks.process(
+            clip, inputs[kInput].voltages, cv, outputs[kOutput].voltages, channels));
+    }
+
+    // Rather than Rack's bypass route, which has no delay, the input goes
+    // through the block buffer untouched. That way bypassing in block mode
+    // doesn't shift the signal in time against the rest of the patch.
+    void processBypass(const ProcessArgs& args) override {
+        governorFeed.step();
+
+        if (!outputs[kOutput].isConnected()) {
+            blocks.reset();
+            return;
+        }
 
         int channels = std::max(inputs[kInput].getChannels(), 1);
-        for (int ch = 0; ch < channels; ch++) {
-            float in = inputs[kInput].getPolyVoltage(ch);
+        blocks.setBlockFrames(blockFrames);
+        outputs[kOutput].setChannels(
+            blocks.bypass(inputs[kInput].voltages, outputs[kOutput].voltages, channels));
+    }
+};
+
+//--------------------------------------------------------------
+// LatencyBadge
+//--------------------------------------------------------------
 
-            float chAmp = amp;
-            if (inputs[kLevelCvInput].isConnected()) {
-                chAmp = chAmp * nextLevelCvAmp(ch);
-            }
+// Shows the block mode latency on the panel while block mode is on.
+struct LatencyBadge : ArcBadge {
 
-            float out = processChannel(ch, in, 5.0f * chAmp);
-            outputs[kOutput].setVoltage(out, ch);
+    CLIP* module = NULL;
+
+    LatencyBadge() : ArcBadge(nvgRGB(0x5E, 0xC8, 0xF2), 34.0f) {
+    }
+
+    std::string getText() override {
+        if (!module || module->blockFrames == 0) {
+            return "";
         }
-        outputs[kOutput].setChannels(channels);
+        return string::f("+%d SMP", module->blockFrames);
     }
 };
 
@@ -134,6 +191,47 @@ struct CLIPWidget : ModuleWidget {
 
         addInput(createInputCentered<ArcPolyPort>(Vec(22.5, 293), module, CLIP::kInput));
         addOutput(createOutputCentered<ArcPolyPort>(Vec(22.5, 334), module, CLIP::kOutput));
+
+        // Above the input, clear of the output's label
+        addChild(createQualityBadgeCentered(Vec(22.5, 256), module));
+        LatencyBadge* badge = createWidgetCentered<LatencyBadge>(Vec(22.5, 268));
+        badge->module = module;
+        addChild(badge);
+    }
+
+    void appendContextMenu(Menu* menu) override {
+        CLIP* module = getModule<CLIP>();
+
+        std::vector<std::string> labels;
+        for (int s = 0; s < arc::dsp::kShapesLen; s++) {
+            labels.push_back(arc::dsp::shapeName(s));
+        }
+
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createIndexSubmenuItem(
+            "Shape",
+            labels,
+            [=]() { return module->shape; },
+            [=](int s) { module->setShape(s); }));
+
+        std::vector<int> blockSizes = {0, 16, 32, 64};
+        menu->addChild(createIndexSubmenuItem(
+            "Block processing",
+            {"Off", "16 samples latency", "32 samples latency", "64 samples latency"},
+            [=]() {
+                auto it = std::find(blockSizes.begin(), blockSizes.end(), module->blockFrames);
+                return (it == blockSizes.end()) ? 0 : (int)(it - blockSizes.begin());
+            },
+            [=](int i) { module->setBlockFrames(blockSizes[i]); }));
+
+        // Silent voices are skipped, so this is what CLIP is actually
+        // spending its time on.
+        menu->addChild(createMenuLabel(string::f(
+            "Voices sounding: %d of %d",
+            module->clip.getActiveChannels(),
+            std::max(module->inputs[CLIP::kInput].getChannels(), 1))));
+
+        appendQualityMenu(menu);
     }
 };
 
@@ -1,4 +1,6 @@
 #include "arc_dsp.hpp"
+#include "arc_fm.hpp"
+#include "governor.hpp"
 #include "plugin.hpp"
 #include "widgets.hpp"
 
@@ -6,6 +8,11 @@
 
 struct FM : Module {
 
+    arc::dsp::FmEngine fm;
+    PolyCv ratioCv;
+    PolyCv offsetCv;
+    GovernorFeed governorFeed;
+
     enum ParamId {
         kRatioParam,
         kRatioCvAmountParam,
@@ -62,54 +69,31 @@ struct FM : Module {
 #endif
     }
 
-    float quantizeRatio(float ratio) {
-        if (ratio < 0.1875f)
-            return 0.125f;
-        else if (ratio < 0.375f)
-            return 0.25f;
-        else if (ratio < 0.75f)
-            return 0.5f;
-        else
-            return round(ratio);
-    }
-
     void process(const ProcessArgs& args) override {
+        governorFeed.step();
 
         if (!outputs[kModulatorPitchOutput].isConnected()) {
             return;
         }
 
-        float pRatio = params[kRatioParam].getValue();
-        float pRatioCvAmount = params[kRatioCvAmountParam].getValue();
-        float pOffset = params[kOffsetParam].getValue();
-        float pOffsetCvAmount = params[kOffsetCvAmountParam].getValue();
-
-        bool pRatioQuant = params[kRatioQuantParam].getValue() < 0.5f;
-
         int channels = std::max(inputs[kCarrierPitchInput].getChannels(), 1);
-        for (int ch = 0; ch < channels; ch++) {
-
-            float inRatioCv = inputs[kRatioCvInput].getPolyVoltage(ch);
-            float inOffsetCv = inputs[kOffsetCvInput].getPolyVoltage(ch);
-            float inCarrierPitch = inputs[kCarrierPitchInput].getPolyVoltage(ch);
 
-            // ratio
-            float ratio = pRatio + inRatioCv * pRatioCvAmount;
-            if (pRatioQuant) {
-                ratio = quantizeRatio(ratio);
-            }
+        int cvDivision = arc::dsp::cvDivision(governor().getTier());
+        fm.ratioCv = ratioCv.gather(inputs[kRatioCvInput], channels, cvDivision);
+        fm.offsetCv = offsetCv.gather(inputs[kOffsetCvInput], channels, cvDivision);
 
-            // offset
-            float offset = pOffset + inOffsetCv * pOffsetCvAmount;
-            offset = offset * 40.0f; // -200Hz to 200 Hz
+        float carrierPitch[engine::PORT_MAX_CHANNELS];
+        for (int ch = 0; ch < channels; ch++) {
+            carrierPitch[ch] = inputs[kCarrierPitchInput].getPolyVoltage(ch);
+        }
 
-            // frequency
-            float carrierFreq = arc::dsp::cvToFrequency(inCarrierPitch);
-            float modulatorFreq = clamp(carrierFreq * ratio + offset, 20.0f, 20000.0f);
-            float outModulatorPitch = arc::dsp::frequencyToCV(modulatorFreq);
+        fm.ratio = params[kRatioParam].getValue();
+        fm.ratioCvAmount = params[kRatioCvAmountParam].getValue();
+        fm.offset = params[kOffsetParam].getValue();
+        fm.offsetCvAmount = params[kOffsetCvAmountParam].getValue();
+        fm.quantizeRatio = params[kRatioQuantParam].getValue() < 0.5f;
 
-            outputs[kModulatorPitchOutput].setVoltage(outModulatorPitch, ch);
-        }
+        fm.processBlock(carrierPitch, outputs[kModulatorPitchOutput].voltages, 1, channels);
         outputs[kModulatorPitchOutput].setChannels(channels);
     }
 };
@@ -140,6 +124,8 @@ struct FMWidget : ModuleWidget {
         addOutput(
             createOutputCentered<ArcPolyPort>(Vec(55.5, 334), module, FM::kModulatorPitchOutput));
 
+        addChild(createQualityBadgeCentered(Vec(37.5, 352), module));
+
 #ifdef FM_DEBUG
         addOutput(createOutputCentered<ArcPolyPort>(Vec(12, 12), module, FM::kDebug1));
         addOutput(createOutputCentered<ArcPolyPort>(Vec(12, 36), module, FM::kDebug2));
@@ -147,6 +133,11 @@ struct FMWidget : ModuleWidget {
         addOutput(createOutputCentered<ArcPolyPort>(Vec(12, 84), module, FM::kDebug4));
 #endif
     }
+
+    void appendContextMenu(Menu* menu) override {
+        menu->addChild(new MenuSeparator);
+        appendQualityMenu(menu);
+    }
 };
 
 Model* modelFM = createModel<FM, FMWidget>("FM");
@@ -1,3 +1,5 @@
+#include "arc_gain.hpp"
+#include "governor.hpp"
 #include "plugin.hpp"
 #include "track.hpp"
 #include "widgets.hpp"
@@ -29,8 +31,9 @@ struct BoostParamQuantity : ParamQuantity {
 
 struct GAIN : Module {
 
-    arc::dsp::Amplifier levelAmp;
-    arc::dsp::Amplifier levelCvAmps[engine::PORT_MAX_CHANNELS];
+    arc::dsp::GainEngine gain;
+    PolyCv levelCv;
+    GovernorFeed governorFeed;
 
     VuStats vuStats;
 
@@ -74,22 +77,15 @@ struct GAIN : Module {
     }
 
     void onSampleRateChange(const SampleRateChangeEvent& e) override {
-
-        levelAmp.onSampleRateChange(e.sampleRate);
-        for (int ch = 0; ch < engine::PORT_MAX_CHANNELS; ch++) {
-            levelCvAmps[ch].onSampleRateChange(e.sampleRate);
-        }
-
+        gain.onSampleRateChange(e.sampleRate);
         vuStats.onSampleRateChange(e.sampleRate);
     }
 
-    float nextLevelCvAmp(int ch) {
-        float v = inputs[kLevelCvInput].getPolyVoltage(ch);
-        float db = rescale(v, 0.0f, 10.0f, kMinDb, kMaxDb);
-        return levelCvAmps[ch].next(db);
-    }
-
     void process(const ProcessArgs& args) override {
+        governorFeed.step();
+
+        int tier = governor().getTier();
+        vuStats.setDivision(arc::dsp::meterDivision(tier));
 
         // Check if anything is connected
         if (!inputs[kInput].isConnected() && !outputs[kOutput].isConnected()) {
@@ -97,54 +93,26 @@ struct GAIN : Module {
             return;
         }
 
-        float sum = 0.0f;
         int channels = std::max(inputs[kInput].getChannels(), 1);
 
-        // Muted
-        if (params[kMuteParam].getValue() > 0.5f) {
-            float amp = levelAmp.next(kMinDb);
+        int cvDivision = arc::dsp::cvDivision(tier);
+        gain.levelCv = levelCv.gather(inputs[kLevelCvInput], channels, cvDivision);
+        gain.coarse = arc::dsp::coarseTables(tier);
 
-            for (int ch = 0; ch < channels; ch++) {
-                float chAmp = amp;
+        float db = levelToDb(params[kLevelParam].getValue());
+        db += rescale(params[kBoostParam].getValue(), 0.0f, 4.0f, -24.0f, 24.0f);
+        gain.level = db;
+        gain.muted = params[kMuteParam].getValue() > 0.5f;
 
-                if (inputs[kLevelCvInput].isConnected()) {
-                    chAmp = chAmp * levelCvAmps[ch].next(kMinDb);
-                }
-
-                float out = clamp(inputs[kInput].getPolyVoltage(ch) * chAmp, -10.0f, 10.0f);
-                if (outputs[kOutput].isConnected()) {
-                    outputs[kOutput].voltages[ch] = out;
-                }
-                sum += out;
-            }
-        }
-        // process normally
-        else {
-
-            float db = levelToDb(params[kLevelParam].getValue());
-            db += rescale(params[kBoostParam].getValue(), 0.0f, 4.0f, -24.0f, 24.0f);
-            float amp = levelAmp.next(db);
-
-            for (int ch = 0; ch < channels; ch++) {
-                float chAmp = amp;
-
-                if (inputs[kLevelCvInput].isConnected()) {
-                    chAmp = chAmp * nextLevelCvAmp(ch);
-                }
-
-                float out = clamp(inputs[kInput].getPolyVoltage(ch) * chAmp, -10.0f, 10.0f);
-                if (outputs[kOutput].isConnected()) {
-                    outputs[kOutput].voltages[ch] = out;
-                }
-                sum += out;
-            }
-        }
+        float scratch[engine::PORT_MAX_CHANNELS];
+        float* out = outputs[kOutput].isConnected() ? outputs[kOutput].voltages : scratch;
+        gain.processBlock(inputs[kInput].voltages, out, 1, channels);
 
         if (outputs[kOutput].isConnected()) {
             outputs[kOutput].channels = channels;
         }
 
-        vuStats.process(args.sampleTime, sum * 0.2f);
+        vuStats.process(args.sampleTime, gain.sum * 0.2f);
     }
 };
 
@@ -183,6 +151,13 @@ struct GAINWidget : ModuleWidget {
 
         addInput(createInputCentered<ArcPolyPort>(Vec(22.5, 293), module, GAIN::kInput));
         addOutput(createOutputCentered<ArcPolyPort>(Vec(22.5, 334), module, GAIN::kOutput));
+
+        addChild(createQualityBadgeCentered(Vec(22.5, 352), module));
+    }
+
+    void appendContextMenu(Menu* menu) override {
+        menu->addChild(new MenuSeparator);
+        appendQualityMenu(menu);
     }
 
     void addMeter(float x, float y, VuStats* vuStats) {
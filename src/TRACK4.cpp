@@ -1,3 +1,6 @@
+#include <ctime>
+
+#include "loudness.hpp"
 #include "plugin.hpp"
 #include "track.hpp"
 #include "widgets.hpp"
@@ -16,8 +19,22 @@ struct TRACK4 : Module {
     bool muted[kNumTracks];
 
     StereoTrack mix;
-    Input mixLeftInput;
-    Input mixRightInput;
+    GovernorFeed governorFeed;
+
+    PackedSend::Mode packedSend = PackedSend::kOff;
+    static_assert(
+        PackedSend::kChannels <= engine::PORT_MAX_CHANNELS, "packed send must fit on one cable");
+
+    // The strip shown by the spectrum analyzer: off, a track, or the mix.
+    static const int kSpectrumOff = 0;
+    static const int kSpectrumMix = kNumTracks + 1;
+    int spectrum = kSpectrumOff;
+
+    // Whether the mix's loudness takes the place of the meters. It is
+    // measured either way, so integrated loudness covers the whole session.
+    bool showLoudness = false;
+
+    float sampleRate = 44100.0f;
 
     enum ParamId {
         ENUMS(kLevelParam, kNumTracks),
@@ -107,40 +124,211 @@ struct TRACK4 : Module {
             tracks[t].init(
                 &(inputs[kLeftInput + t]),
                 &(inputs[kRightInput + t]),
+                &(outputs[kLeftSend + t]),
+                &(outputs[kRightSend + t]),
                 &(params[kLevelParam + t]),
                 &(inputs[kLevelCvInput + t]),
                 &(params[kPanParam + t]),
                 &(inputs[kPanCvInput + t]));
         }
 
+        // The mix track reads from the Send Mix voltages, so it has no input
+        // ports and no per-channel outputs of its own.
+        mix.enableLoudness();
         mix.init(
-            &mixLeftInput,
-            &mixRightInput,
+            NULL,
+            NULL,
+            NULL,
+            NULL,
             &(params[kMixLevelParam]),
             &(inputs[kMixLevelCvInput]),
             &(params[kMixPanParam]),
             &(inputs[kMixPanCvInput]));
-
-        mixLeftInput.channels = kNumTracks;
-        mixRightInput.channels = kNumTracks;
     }
 
     void onSampleRateChange(const SampleRateChangeEvent& e) override {
+        sampleRate = e.sampleRate;
         for (int t = 0; t < TRACK4::kNumTracks; t++) {
             tracks[t].onSampleRateChange(e.sampleRate);
         }
         mix.onSampleRateChange(e.sampleRate);
     }
 
-    void processSend(Port& port, Output& send) {
-        if (send.isConnected()) {
-            send.setChannels(port.channels);
-            send.writeVoltages(port.voltages);
+    json_t* dataToJson() override {
+        json_t* root = json_object();
+        json_object_set_new(root, "packedSend", json_integer(packedSend));
+        json_object_set_new(root, "spectrum", json_integer(spectrum));
+        json_object_set_new(root, "truePeak", json_boolean(getTruePeakMode()));
+        json_object_set_new(root, "showLoudness", json_boolean(showLoudness));
+
+        json_t* saturationJ = json_array();
+        for (int s = 0; s <= kNumTracks; s++) {
+            json_array_append_new(saturationJ, json_boolean(getStrip(s).getSaturation()));
+        }
+        json_object_set_new(root, "saturation", saturationJ);
+
+        return root;
+    }
+
+    void dataFromJson(json_t* root) override {
+        json_t* packedSendJ = json_object_get(root, "packedSend");
+        if (packedSendJ) {
+            setPackedSend((PackedSend::Mode)json_integer_value(packedSendJ));
+        }
+
+        json_t* spectrumJ = json_object_get(root, "spectrum");
+        if (spectrumJ) {
+            setSpectrum(json_integer_value(spectrumJ));
+        }
+
+        json_t* truePeakJ = json_object_get(root, "truePeak");
+        if (truePeakJ) {
+            setTruePeakMode(json_boolean_value(truePeakJ));
+        }
+
+        json_t* showLoudnessJ = json_object_get(root, "showLoudness");
+        if (showLoudnessJ) {
+            setShowLoudness(json_boolean_value(showLoudnessJ));
+        }
+
+        json_t* saturationJ = json_object_get(root, "saturation");
+        for (int s = 0; s <= kNumTracks && s < (int)json_array_size(saturationJ); s++) {
+            getStrip(s).setSaturation(json_boolean_value(json_array_get(saturationJ, s)));
+        }
+    }
+
+    // Strips are numbered 0 to kNumTracks - 1 for the tracks, then the mix.
+    StereoTrack& getStrip(int s) {
+        return (s == kNumTracks) ? mix : tracks[s];
+    }
+
+    static std::string stripName(int s) {
+        return (s == kNumTracks) ? "Mix" : string::f("Track %d", s + 1);
+    }
+
+    StereoTrack* getSpectrumTrack() {
+        if (spectrum == kSpectrumOff) {
+            return NULL;
+        }
+        return &getStrip(spectrum - 1);
+    }
+
+    // Only the taps of the strip picked in the menu are enabled, so with the
+    // analyzer off the audio thread does no extra work at all. Even those
+    // only listen while the analyzer is drawn; see AudioTap.
+    void setSpectrum(int s) {
+        if (s < kSpectrumOff || s > kSpectrumMix) {
+            s = kSpectrumOff;
+        }
+        spectrum = s;
+        if (spectrum != kSpectrumOff) {
+            showLoudness = false;
+        }
+
+        for (int t = 0; t < kNumTracks; t++) {
+            tracks[t].left.tap.setEnabled(false);
+            tracks[t].right.tap.setEnabled(false);
+        }
+        mix.left.tap.setEnabled(false);
+        mix.right.tap.setEnabled(false);
+
+        StereoTrack* track = getSpectrumTrack();
+        if (track) {
+            track->left.tap.setEnabled(true);
+            track->right.tap.setEnabled(true);
+        }
+    }
+
+    // The loudness display and the spectrum analyzer share the meters' place
+    // on the panel, so showing one hides the other.
+    void setShowLoudness(bool showLoudness_) {
+        if (showLoudness_) {
+            setSpectrum(kSpectrumOff);
+        }
+        showLoudness = showLoudness_;
+    }
+
+    // All ten meters switch together.
+    void setTruePeakMode(bool truePeakMode) {
+        for (int s = 0; s <= kNumTracks; s++) {
+            getStrip(s).setTruePeakMode(truePeakMode);
+        }
+    }
+
+    bool getTruePeakMode() {
+        return mix.getTruePeakMode();
+    }
+
+    // In packed mode the Send Mix Left jack carries every strip, and Send
+    // Mix Right is left idle.
+    void setPackedSend(PackedSend::Mode mode) {
+        if (mode < PackedSend::kOff || mode >= PackedSend::kModesLen) {
+            mode = PackedSend::kOff;
+        }
+        packedSend = mode;
+
+        if (packedSend == PackedSend::kOff) {
+            outputInfos[kMixLeftSend]->name = "Send Mix Left";
+            outputInfos[kMixRightSend]->name = "Send Mix Right";
         } else {
-            send.setChannels(0);
+            outputInfos[kMixLeftSend]->name = "Packed Send";
+            outputInfos[kMixRightSend]->name = "Send Mix Right (unused when packed)";
+        }
+    }
+
+    static std::string captureDirectory() {
+        return asset::user("AutonomousRobotCollective/captures");
+    }
+
+    // Starts or stops capturing a strip. Each capture goes to a new file,
+    // named after the module, the strip and the time it started.
+    void toggleCapture(int s) {
+        arc::dsp::Capture& capture = getStrip(s).capture;
+
+        if (capture.isRecording()) {
+            capture.stop();
+            if (capture.getDropped() > 0) {
+                WARN(
+                    "TRACK4 %s capture dropped %d buffers",
+                    stripName(s).c_str(),
+                    capture.getDropped());
+            }
+            return;
+        }
+
+        char stamp[32];
+        std::time_t now = std::time(NULL);
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", std::localtime(&now));
+
+        std::string strip = (s == kNumTracks) ? "Mix" : string::f("Track%d", s + 1);
+
+        std::string dir = captureDirectory();
+        system::createDirectories(dir);
+        std::string path = system::join(
+            dir, string::f("TRACK4-%lld-%s-%s.wav", (long long)id, strip.c_str(), stamp));
+
+        if (!capture.start(path, (int)sampleRate)) {
+            WARN("TRACK4 could not start capture to %s", path.c_str());
         }
     }
 
+    void processPackedSend() {
+
+        Output& packed = outputs[kMixLeftSend];
+        if (packed.isConnected()) {
+            for (int t = 0; t < TRACK4::kNumTracks; t++) {
+                PackedSend::pack(
+                    packedSend, tracks[t].left, &packed.voltages[PackedSend::channel(t, 0, 0)]);
+                PackedSend::pack(
+                    packedSend, tracks[t].right, &packed.voltages[PackedSend::channel(t, 1, 0)]);
+            }
+            packed.setChannels(PackedSend::kChannels);
+        }
+
+        outputs[kMixRightSend].setVoltage(0.0f);
+        outputs[kMixRightSend].setChannels(1);
+    }
+
     void processMixOutput(float val, Output& output) {
         if (output.isConnected()) {
             output.setChannels(1);
@@ -151,23 +339,34 @@ struct TRACK4 : Module {
     }
 
     void process(const ProcessArgs& args) override {
+        governorFeed.step();
+
+        // The track sums are staged directly in the Send Mix voltages, which
+        // then serve as the mix track's input. Writing voltages to a
+        // disconnected output is harmless, so this works either way.
+        float* mixLeft = outputs[kMixLeftSend].voltages;
+        float* mixRight = outputs[kMixRightSend].voltages;
 
         for (int t = 0; t < TRACK4::kNumTracks; t++) {
             bool muted = params[kMuteParam + t].getValue() > 0.5f;
             tracks[t].process(args.sampleTime, muted);
 
-            processSend(tracks[t].left.output, outputs[kLeftSend + t]);
-            processSend(tracks[t].right.output, outputs[kRightSend + t]);
-
-            mixLeftInput.setVoltage(tracks[t].left.sum, t);
-            mixRightInput.setVoltage(tracks[t].right.sum, t);
+            mixLeft[t] = tracks[t].left.sum;
+            mixRight[t] = tracks[t].right.sum;
         }
 
-        processSend(mixLeftInput, outputs[kMixLeftSend]);
-        processSend(mixRightInput, outputs[kMixRightSend]);
+        if (packedSend == PackedSend::kOff) {
+            outputs[kMixLeftSend].setChannels(kNumTracks);
+            outputs[kMixRightSend].setChannels(kNumTracks);
+        }
 
         bool muted = params[kMixMuteParam].getValue() > 0.5f;
-        mix.process(args.sampleTime, muted);
+        mix.process(args.sampleTime, mixLeft, mixRight, kNumTracks, muted);
+
+        // This overwrites the staged sums, so it must follow the mix track.
+        if (packedSend != PackedSend::kOff) {
+            processPackedSend();
+        }
         processMixOutput(mix.left.sum, outputs[kMixLeftOutput]);
         processMixOutput(mix.right.sum, outputs[kMixRightOutput]);
     }
@@ -179,6 +378,10 @@ struct TRACK4 : Module {
 
 struct TRACK4Widget : ModuleWidget {
 
+    std::vector<VuMeter*> meters;
+    SpectrumAnalyzer* analyzer = NULL;
+    LoudnessDisplay* loudnessDisplay = NULL;
+
     TRACK4Widget(TRACK4* module) {
         setModule(module);
         setPanel(createPanel(asset::plugin(pluginInstance, "res/TRACK4.svg")));
@@ -241,6 +444,22 @@ struct TRACK4Widget : ModuleWidget {
         addOutput(createOutputCentered<ArcPolyPort>(Vec(234, y), module, TRACK4::kMixLeftSend));
         addOutput(
             createOutputCentered<ArcPolyPort>(Vec(234, y + 29), module, TRACK4::kMixRightSend));
+
+        // The spectrum analyzer takes the place of the meters while it's on.
+        analyzer = new SpectrumAnalyzer();
+        analyzer->box.pos = Vec(22, 44);
+        analyzer->box.size = Vec(171, 104);
+        analyzer->hide();
+        addChild(analyzer);
+
+        loudnessDisplay = new LoudnessDisplay();
+        loudnessDisplay->box.pos = analyzer->box.pos;
+        loudnessDisplay->box.size = analyzer->box.size;
+        loudnessDisplay->setLoudness(module ? module->mix.loudness.get() : NULL);
+        loudnessDisplay->hide();
+        addChild(loudnessDisplay);
+
+        addChild(createQualityBadgeCentered(Vec(box.size.x / 2, 38), module));
     }
 
     void addMeter(float x, float y, VuStats* vuStats) {
@@ -248,6 +467,98 @@ struct TRACK4Widget : ModuleWidget {
         meter->box.pos = Vec(x, y);
         meter->box.size = Vec(8, 104);
         addChild(meter);
+        meters.push_back(meter);
+    }
+
+    void step() override {
+        TRACK4* module = getModule<TRACK4>();
+        if (module) {
+            StereoTrack* track = module->getSpectrumTrack();
+            if (track) {
+                analyzer->setTaps(&track->left.tap, &track->right.tap);
+                analyzer->show();
+            } else {
+                analyzer->hide();
+            }
+            loudnessDisplay->visible = module->showLoudness;
+            for (VuMeter* meter : meters) {
+                meter->visible = !track && !module->showLoudness;
+            }
+        }
+        ModuleWidget::step();
+    }
+
+    void appendContextMenu(Menu* menu) override {
+        TRACK4* module = getModule<TRACK4>();
+
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createIndexSubmenuItem(
+            "Send Mix",
+            {"Separate Left/Right", "Packed, summed tracks", "Packed, first 2 voices"},
+            [=]() { return module->packedSend; },
+            [=](int mode) { module->setPackedSend((PackedSend::Mode)mode); }));
+
+        std::vector<std::string> labels = {"Off"};
+        for (int s = 0; s <= TRACK4::kNumTracks; s++) {
+            labels.push_back(TRACK4::stripName(s));
+        }
+
+        menu->addChild(createIndexSubmenuItem(
+            "Spectrum",
+            labels,
+            [=]() { return module->spectrum; },
+            [=](int s) { module->setSpectrum(s); }));
+
+        menu->addChild(createSubmenuItem("Loudness", "", [=](Menu* menu) {
+            menu->addChild(createBoolMenuItem(
+                "Show on panel",
+                "",
+                [=]() { return module->showLoudness; },
+                [=](bool show) { module->setShowLoudness(show); }));
+            menu->addChild(createMenuItem(
+                "Reset integrated", "", [=]() { module->mix.loudness->resetIntegrated(); }));
+        }));
+
+        menu->addChild(createBoolMenuItem(
+            "True peak meters",
+            "",
+            [=]() { return module->getTruePeakMode(); },
+            [=](bool on) { module->setTruePeakMode(on); }));
+
+        menu->addChild(createSubmenuItem("Saturation", "", [=](Menu* menu) {
+            for (int s = 0; s <= TRACK4::kNumTracks; s++) {
+                menu->addChild(createBoolMenuItem(
+                    TRACK4::stripName(s),
+                    "",
+                    [=]() { return module->getStrip(s).getSaturation(); },
+                    [=](bool on) { module->getStrip(s).setSaturation(on); }));
+            }
+        }));
+
+        menu->addChild(createSubmenuItem("Capture", "", [=](Menu* menu) {
+            menu->addChild(createMenuLabel(TRACK4::captureDirectory()));
+
+            for (int s = 0; s <= TRACK4::kNumTracks; s++) {
+                arc::dsp::Capture& capture = module->getStrip(s).capture;
+
+                std::string status;
+                if (capture.isFull()) {
+                    status = "full";
+                } else if (capture.getDropped() > 0) {
+                    status = string::f("%d dropped", capture.getDropped());
+                } else if (capture.isBusy() && !capture.isRecording()) {
+                    status = "finishing";
+                }
+
+                menu->addChild(createCheckMenuItem(
+                    TRACK4::stripName(s),
+                    status,
+                    [=]() { return module->getStrip(s).capture.isRecording(); },
+                    [=]() { module->toggleCapture(s); }));
+            }
+        }));
+
+        appendQualityMenu(menu);
     }
 };
 
@@ -0,0 +1,14 @@
+#include "arc_atv.hpp"
+
+namespace arc {
+namespace dsp {
+
+void AttenuverterEngine::processBlock(const float* in, float* out, int frames, int channels) {
+    int samples = frames * channels;
+    for (int i = 0; i < samples; i++) {
+        out[i] = in[i] * amount;
+    }
+}
+
+} // namespace dsp
+} // namespace arc
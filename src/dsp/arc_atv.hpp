@@ -0,0 +1,21 @@
+#pragma once
+
+// The ATV engine: scales a signal by an amount from -1 to 1. This header does
+// not depend on Rack.
+
+namespace arc {
+namespace dsp {
+
+class AttenuverterEngine {
+
+  public:
+
+    // Read by each processBlock().
+    float amount = 0.0f;
+
+    // in and out hold `frames` frames of `channels` interleaved samples.
+    void processBlock(const float* in, float* out, int frames, int channels);
+};
+
+} // namespace dsp
+} // namespace arc
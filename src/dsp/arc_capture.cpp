@@ -0,0 +1,121 @@
+#include "arc_capture.hpp"
+
+#include <chrono>
+
+namespace arc {
+namespace dsp {
+
+// How often the writer thread wakes up to look for full blocks. The ring
+// holds far more than this, so polling keeps the audio thread from ever
+// having to signal it.
+static const int kPollMillis = 10;
+
+// stdio buffer for the file, so the disk sees large sequential writes.
+static const size_t kFileBufferSize = 1 << 20;
+
+//--------------------------------------------------------------
+// Capture
+//--------------------------------------------------------------
+
+Capture::~Capture() {
+    if (writer.joinable()) {
+        // The audio thread no longer runs this module, so hand over the
+        // partial block on its behalf.
+        stop();
+        handOver();
+        writer.join();
+    }
+}
+
+bool Capture::start(const std::string& path, int sampleRate_) {
+    if (isBusy()) {
+        return false;
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    fileBuffer.resize(kFileBufferSize);
+    std::setvbuf(file, fileBuffer.data(), _IOFBF, fileBuffer.size());
+
+    sampleRate = sampleRate_;
+    framesWritten = 0;
+    writeWavHeader(file, sampleRate, kChannels, 0);
+
+    ring.resize(kBlocks * kBlockSize);
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    dropped.store(0, std::memory_order_relaxed);
+    full.store(false, std::memory_order_relaxed);
+    frame = 0;
+    dropping = false;
+
+    state.store(kRecording, std::memory_order_release);
+    writer = std::thread(&Capture::run, this);
+    return true;
+}
+
+void Capture::stop() {
+    int s = kRecording;
+    state.compare_exchange_strong(s, kStopping);
+}
+
+void Capture::run() {
+    int stoppingMillis = 0;
+    while (true) {
+        int s = state.load(std::memory_order_acquire);
+        bool final = s == kStopped;
+        drain(final);
+        if (final) {
+            break;
+        }
+
+        // The audio thread has stopped calling process(), because the module
+        // is bypassed or the engine is paused. Its partial block can't
+        // safely be read from here, so the file ends with the last full
+        // block.
+        if (s == kStopping) {
+            stoppingMillis += kPollMillis;
+            int expected = kStopping;
+            if (stoppingMillis >= kStopTimeoutMillis &&
+                state.compare_exchange_strong(expected, kHandingOver)) {
+                lastFrames = kBlockFrames;
+                state.store(kStopped, std::memory_order_release);
+                continue;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(kPollMillis));
+    }
+
+    writeWavHeader(file, sampleRate, kChannels, framesWritten);
+    std::fclose(file);
+    file = NULL;
+
+    state.store(kIdle, std::memory_order_release);
+}
+
+// Writes every block the audio thread has published. On the final drain,
+// the last block may be partial. Past kMaxFrames, blocks are discarded.
+void Capture::drain(bool final) {
+    uint32_t h = head.load(std::memory_order_acquire);
+
+    for (uint32_t t = tail.load(std::memory_order_relaxed); t != h; t++) {
+        int frames = (final && t + 1 == h) ? lastFrames : kBlockFrames;
+
+        if ((uint32_t)frames > kMaxFrames - framesWritten) {
+            frames = kMaxFrames - framesWritten;
+            full.store(true, std::memory_order_relaxed);
+        }
+        std::fwrite(&ring[(t & kMask) * kBlockSize], sizeof(float), frames * kChannels, file);
+        framesWritten += frames;
+
+        tail.store(t + 1, std::memory_order_release);
+    }
+}
+
+} // namespace dsp
+} // namespace arc
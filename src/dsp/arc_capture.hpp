@@ -0,0 +1,183 @@
+#pragma once
+
+// Streams stereo audio from the audio thread to a WAV file.
+//
+// The audio thread fills fixed-size blocks of a preallocated ring, and hands
+// each full block to a background writer thread, which streams it to disk
+// through a large stdio buffer. The audio thread never blocks, allocates or
+// makes a system call: if the writer has fallen so far behind that there is
+// no free block, the samples for that block are dropped and counted instead.
+//
+// Samples are stored as 32-bit float, scaled the way arc-render writes its
+// stems, with 10V at full scale, so a capture can be compared with a render
+// sample for sample. A WAV file can't hold 4 GiB of samples or more, so once
+// a capture reaches that, a little over 3 hours at 48kHz, the rest is
+// discarded. This header does not depend on Rack.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "arc_wav.hpp"
+
+namespace arc {
+namespace dsp {
+
+class Capture {
+
+  public:
+
+    static const int kChannels = 2;
+    static const int kBlockFrames = 1024;
+
+    // Must be a power of 2. At 48kHz this is about 2.7 seconds of slack.
+    static const int kBlocks = 128;
+
+    static const int kStopTimeoutMillis = 500;
+
+    // The most frames a WAV file's 32-bit sizes can describe.
+    static const uint32_t kMaxFrames =
+        (UINT32_MAX - (kWavHeaderSize - 8)) / (kChannels * sizeof(float));
+
+    Capture() {
+    }
+
+    ~Capture();
+
+    Capture(const Capture&) = delete;
+    Capture& operator=(const Capture&) = delete;
+
+    // UI thread. Creates the file and starts the writer thread. Fails if the
+    // file can't be created, or if the previous capture is still finishing.
+    bool start(const std::string& path, int sampleRate_);
+
+    // UI thread. Asks the audio thread to hand over its last, partial block;
+    // the writer thread then finishes the file on its own. If the audio
+    // thread doesn't call process() within kStopTimeoutMillis, because the
+    // module is bypassed or the engine is paused, the writer finishes the
+    // file without the partial block.
+    void stop();
+
+    // True from start() until stop().
+    bool isRecording() const {
+        return state.load(std::memory_order_acquire) == kRecording;
+    }
+
+    // True from start() until the file is finished.
+    bool isBusy() const {
+        return state.load(std::memory_order_acquire) != kIdle;
+    }
+
+    // The number of blocks dropped since start().
+    int getDropped() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    // True once the file has reached kMaxFrames, from then until start().
+    bool isFull() const {
+        return full.load(std::memory_order_relaxed);
+    }
+
+    // Audio thread, once per sample, in volts. Cheap when idle.
+    void process(float left, float right) {
+        int s = state.load(std::memory_order_acquire);
+        if (s == kRecording) {
+            push(left, right);
+        } else if (s == kStopping) {
+            handOver();
+        }
+    }
+
+  private:
+
+    // kHandingOver is held by whichever thread won the race to finish a
+    // stop: the audio thread, or the writer once it has given up waiting.
+    enum State { kIdle, kRecording, kStopping, kHandingOver, kStopped };
+
+    static const int kBlockSize = kBlockFrames * kChannels;
+    static const uint32_t kMask = kBlocks - 1;
+
+    std::atomic<int> state{kIdle};
+
+    // Allocated by the first start(), and reused after that.
+    std::vector<float> ring;
+
+    // Blocks published by the audio thread, and consumed by the writer.
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+
+    // The number of frames in the last block published, which may be
+    // partial. Only valid once the state is kStopped.
+    int lastFrames = 0;
+
+    std::atomic<int> dropped{0};
+    std::atomic<bool> full{false};
+
+    // Owned by the audio thread.
+    int frame = 0;
+    bool dropping = false;
+
+    // Owned by the writer thread.
+    std::FILE* file = NULL;
+    int sampleRate = 0;
+    std::vector<char> fileBuffer;
+    uint32_t framesWritten = 0;
+    std::thread writer;
+
+    void push(float left, float right) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+
+        // At the start of each block, check whether the writer has freed
+        // it yet.
+        if (frame == 0) {
+            dropping = (h - tail.load(std::memory_order_acquire)) >= (uint32_t)kBlocks;
+        }
+
+        if (!dropping) {
+            float* block = &ring[(h & kMask) * kBlockSize];
+            block[frame * kChannels] = left / 10.0f;
+            block[frame * kChannels + 1] = right / 10.0f;
+        }
+
+        if (++frame == kBlockFrames) {
+            frame = 0;
+            if (dropping) {
+                dropped.store(getDropped() + 1, std::memory_order_relaxed);
+            } else {
+                head.store(h + 1, std::memory_order_release);
+            }
+        }
+    }
+
+    void publishPartial() {
+        lastFrames = kBlockFrames;
+        if (frame > 0) {
+            if (dropping) {
+                dropped.store(getDropped() + 1, std::memory_order_relaxed);
+            } else {
+                lastFrames = frame;
+                head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+        }
+        frame = 0;
+    }
+
+    // Publishes the partial block and moves on to kStopped, unless another
+    // thread already has.
+    void handOver() {
+        int s = kStopping;
+        if (state.compare_exchange_strong(s, kHandingOver, std::memory_order_acq_rel)) {
+            publishPartial();
+            state.store(kStopped, std::memory_order_release);
+        }
+    }
+
+    void run();
+    void drain(bool final);
+};
+
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,251 @@
+#include "arc_clip.hpp"
+
+namespace arc {
+namespace dsp {
+
+ClipEngine::ClipEngine() {
+    for (int ch = 0; ch < kKernelWidth; ch++) {
+        oversample.push_back(Oversample(kOversampleFactor));
+    }
+}
+
+void ClipEngine::onSampleRateChange(float sampleRate_) {
+    sampleRate = sampleRate_;
+    levelAmp.onSampleRateChange(sampleRate);
+    for (int ch = 0; ch < kKernelWidth; ch++) {
+        levelCvAmps[ch].onSampleRateChange(sampleRate);
+        oversample[ch].onSampleRateChange(sampleRate);
+    }
+}
+
+void ClipEngine::setOversample(int factor) {
+    if (factor == oversampleFactor || factor < 1 || factor > kOversampleFactor) {
+        return;
+    }
+    oversampleFactor = factor;
+    for (int ch = 0; ch < kKernelWidth; ch++) {
+        oversample[ch] = Oversample(oversampleFactor);
+        oversample[ch].onSampleRateChange(sampleRate);
+    }
+    quietMask = 0xFFFFFFFF;
+}
+
+void ClipEngine::processBlock(const float* in, float* out, int frames, int channels) {
+
+    const Kernels& k = kernels();
+
+    // Each active channel's oversampled chunk is one contiguous run in the
+    // buffer, packed one after another, with its limit alongside each
+    // sub-sample. Only the active channels' runs are written. The shaper
+    // takes the runs of all the active channels as one stream of vectors.
+    //
+    // The anti-aliasing filters see each run whole, and filter a run of 16
+    // sub-samples or more as a wavefront. Live, Rack hands over one frame
+    // at a time, and a run of 4 sub-samples is too short for that, so live
+    // use gains nothing from it: each channel's filters go one section at a
+    // time, as they did before.
+    float buffer[kChunkFrames * kOversampleFactor * kKernelWidth];
+    float limits[kChunkFrames * kOversampleFactor * kKernelWidth];
+
+    for (int start = 0; start < frames;) {
+        int chunk = kChunkFrames - phase;
+        chunk = (frames - start < chunk) ? frames - start : chunk;
+
+        const float* chunkIn = in + start * channels;
+        float* chunkOut = out + start * channels;
+
+        // A channel that wasn't heard in the chunk before a boundary is
+        // skipped from then on, once its filters settle, and they're reset
+        // so that it comes back from exact silence.
+        if (phase == 0) {
+            for (int ch = 0; ch < channels; ch++) {
+                uint32_t bit = 1u << ch;
+                if (!((quietMask | heardMask) & bit) && oversample[ch].isSettled(kSettled)) {
+                    oversample[ch].reset();
+                    quietMask |= bit;
+                }
+            }
+            heardMask = 0;
+        }
+
+        // The lane each channel is packed into, or -1 if it's skipped. Any
+        // input at all brings a quiet channel back straight away. Its
+        // filters have only seen silence, so the frames before the input
+        // come out as 0V whichever chunk it wakes in.
+        int lanes[kKernelWidth];
+        int channelOf[kKernelWidth];
+        int active = 0;
+        activeMask = 0;
+        for (int ch = 0; ch < channels; ch++) {
+            uint32_t bit = 1u << ch;
+
+            bool silent = true;
+            for (int f = 0; f < chunk; f++) {
+                silent = silent && chunkIn[f * channels + ch] == 0.0f;
+            }
+            if (!silent) {
+                heardMask |= bit;
+                quietMask &= ~bit;
+            }
+
+            if (quietMask & bit) {
+                lanes[ch] = -1;
+                for (int f = 0; f < chunk; f++) {
+                    chunkOut[f * channels + ch] = 0.0f;
+                }
+            } else {
+                lanes[ch] = active;
+                channelOf[active++] = ch;
+                activeMask |= bit;
+            }
+        }
+        activeChannels = active;
+
+        // Every channel's level ramps keep moving, active or not.
+        int run = chunk * oversampleFactor;
+        for (int f = 0; f < chunk; f++) {
+            int base = (start + f) * channels;
+
+            float amp = levelAmp.next(level, coarse);
+            for (int ch = 0; ch < channels; ch++) {
+                float chAmp = amp;
+                if (levelCv) {
+                    chAmp = chAmp * levelCvAmps[ch].next(levelCvToDb(levelCv[base + ch]), coarse);
+                }
+                if (lanes[ch] >= 0) {
+                    float* lim = limits + lanes[ch] * run + f * oversampleFactor;
+                    for (int i = 0; i < oversampleFactor; i++) {
+                        lim[i] = 5.0f * chAmp;
+                    }
+                }
+            }
+        }
+
+        if (active > 0) {
+            for (int lane = 0; lane < active; lane++) {
+                int ch = channelOf[lane];
+                oversample[ch].upsample(chunkIn + ch, channels, chunk, buffer + lane * run, 1);
+            }
+
+            // The shaper is quickest on whole vectors, so the runs are padded
+            // out to a multiple of 8 with silence.
+            int shaped = active * run;
+            for (; shaped % 8 != 0; shaped++) {
+                buffer[shaped] = 0.0f;
+                limits[shaped] = 1.0f;
+            }
+            k.shape[shape](buffer, limits, shaped);
+
+            for (int lane = 0; lane < active; lane++) {
+                int ch = channelOf[lane];
+                oversample[ch].downsample(buffer + lane * run, 1, chunk, chunkOut + ch, channels);
+            }
+        }
+
+        start += chunk;
+        phase = (phase + chunk) % kChunkFrames;
+    }
+}
+
+//--------------------------------------------------------------
+// ClipBlockBuffer
+//--------------------------------------------------------------
+
+ClipBlockBuffer::ClipBlockBuffer()
+    : in(kMaxBlockFrames * kKernelWidth),
+      levelCv(kMaxBlockFrames * kKernelWidth),
+      out(kMaxBlockFrames * kKernelWidth) {
+}
+
+void ClipBlockBuffer::setBlockFrames(int frames) {
+    frames = (frames < 0) ? 0 : ((frames > kMaxBlockFrames) ? kMaxBlockFrames : frames);
+    if (frames == blockFrames) {
+        return;
+    }
+    blockFrames = frames;
+    reset();
+}
+
+int ClipBlockBuffer::exchange(
+    const float* in_,
+    const float* levelCv_,
+    float* out_,
+    int channels) {
+
+    if (pos == 0) {
+        fillChannels = channels;
+        fillLevelCv = (levelCv_ != NULL);
+    }
+
+    // Channels added since the block started wait for the next one, and
+    // channels removed are silent. A CV unpatched partway through holds its
+    // last value.
+    float* inFrame = in.data() + pos * fillChannels;
+    float* cvFrame = levelCv.data() + pos * fillChannels;
+    for (int ch = 0; ch < fillChannels; ch++) {
+        bool live = ch < channels;
+        inFrame[ch] = live ? in_[ch] : 0.0f;
+        if (fillLevelCv) {
+            cvFrame[ch] = (live && levelCv_) ? levelCv_[ch] : cvFrame[ch - fillChannels];
+        }
+    }
+
+    const float* outFrame = out.data() + pos * outChannels;
+    for (int ch = 0; ch < outChannels; ch++) {
+        out_[ch] = silent ? 0.0f : outFrame[ch];
+    }
+
+    pos++;
+    return outChannels;
+}
+
+// Every frame of the last block has been played, so it can be overwritten.
+void ClipBlockBuffer::finishBlock() {
+    outChannels = fillChannels;
+    silent = false;
+    pos = 0;
+}
+
+int ClipBlockBuffer::process(
+    ClipEngine& engine,
+    const float* in_,
+    const float* levelCv_,
+    float* out_,
+    int channels) {
+
+    if (blockFrames == 0) {
+        engine.levelCv = levelCv_;
+        engine.processBlock(in_, out_, 1, channels);
+        return channels;
+    }
+
+    int written = exchange(in_, levelCv_, out_, channels);
+    if (pos == blockFrames) {
+        engine.levelCv = fillLevelCv ? levelCv.data() : NULL;
+        engine.processBlock(in.data(), out.data(), blockFrames, fillChannels);
+        finishBlock();
+    }
+    return written;
+}
+
+int ClipBlockBuffer::bypass(const float* in_, float* out_, int channels) {
+
+    if (blockFrames == 0) {
+        for (int ch = 0; ch < channels; ch++) {
+            out_[ch] = in_[ch];
+        }
+        return channels;
+    }
+
+    int written = exchange(in_, NULL, out_, channels);
+    if (pos == blockFrames) {
+        for (int i = 0; i < blockFrames * fillChannels; i++) {
+            out[i] = in[i];
+        }
+        finishBlock();
+    }
+    return written;
+}
+
+} // namespace dsp
+} // namespace arc
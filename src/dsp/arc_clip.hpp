@@ -0,0 +1,164 @@
+#pragma once
+
+// The CLIP engine: a smoothed level with optional per-channel level CV,
+// which sets the ceiling of a 4x (or 2x) oversampled waveshaper. Silent
+// channels are skipped, and the rest are packed together before they're
+// shaped, so the cost follows the number of voices sounding rather than the
+// cable's channel count. This header does not depend on Rack.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "arc_filter.hpp"
+#include "arc_kernels.hpp"
+#include "arc_ramp.hpp"
+
+namespace arc {
+namespace dsp {
+
+class ClipEngine {
+
+    Amplifier levelAmp;
+    Amplifier levelCvAmps[kKernelWidth];
+    std::vector<Oversample> oversample;
+    int oversampleFactor = kOversampleFactor;
+    float sampleRate = 44100.0f;
+
+    // One bit per channel. Quiet channels have had silent input since their
+    // filters were last reset, so they'd only ever output 0V. Heard
+    // channels have had input since the last chunk boundary. Active
+    // channels were processed in the last chunk.
+    uint32_t quietMask = 0xFFFFFFFF;
+    uint32_t heardMask = 0;
+    uint32_t activeMask = 0;
+    int activeChannels = 0;
+
+    // Frames since the last chunk boundary. Boundaries fall every
+    // kChunkFrames frames of the stream, however it's split into calls.
+    int phase = 0;
+
+  public:
+
+    // The default, and the most processBlock() supports.
+    static const int kOversampleFactor = 4;
+
+    // The most frames processBlock() oversamples at once. It splits its
+    // frames into chunks that end on boundaries every kChunkFrames frames.
+    static const int kChunkFrames = 16;
+
+    // A channel goes quiet at a chunk boundary if its input was silent for
+    // the whole chunk before it, and its filters have settled to within
+    // this many volts of 0. Since that's only decided at boundaries, the
+    // output doesn't depend on how many frames each call gets.
+    static constexpr double kSettled = 1e-6;
+
+    // Read by each processBlock().
+    float level = 0.0f;  // in dB
+    int shape = kCubic; // a Shape
+
+    // 0V to 10V per channel, laid out like the audio, or NULL if unpatched.
+    const float* levelCv = NULL;
+
+    // Use the coarse level law of the lowest quality tier.
+    bool coarse = false;
+
+    ClipEngine();
+
+    void onSampleRateChange(float sampleRate_);
+
+    // Switches to oversampling by 2 or 4. Each switch restarts the
+    // anti-aliasing filters, which may click. Doesn't allocate.
+    void setOversample(int factor);
+
+    int getOversample() const {
+        return oversampleFactor;
+    }
+
+    // The channels processed in the last chunk, one bit each, and how many.
+    // The rest were silent and left out, so they cost next to nothing.
+    uint32_t getActiveMask() const {
+        return activeMask;
+    }
+
+    int getActiveChannels() const {
+        return activeChannels;
+    }
+
+    // in and out hold `frames` frames of `channels` interleaved samples.
+    void processBlock(const float* in, float* out, int frames, int channels);
+};
+
+//--------------------------------------------------------------
+// ClipBlockBuffer
+//--------------------------------------------------------------
+
+// Runs a ClipEngine a block at a time for a caller that has one frame at a
+// time, such as Rack. Each frame comes out exactly one block after it went
+// in. The channel count, and whether the level CV is patched, are read once
+// per block, when the block starts filling. The engine's own settings, such
+// as level, shape and coarse, are read by its processBlock(), when the block
+// has filled.
+class ClipBlockBuffer {
+
+    std::vector<float> in;
+    std::vector<float> levelCv;
+    std::vector<float> out;
+
+    int blockFrames = 0;
+    int pos = 0;
+
+    int fillChannels = 1;
+    bool fillLevelCv = false;
+    int outChannels = 1;
+
+    // Set by reset(): the output is silent until the next block is
+    // processed.
+    bool silent = true;
+
+    // Queues a frame and writes out the one from a block ago, as process()
+    // does, leaving the full block for the caller to finish.
+    int exchange(const float* in_, const float* levelCv_, float* out_, int channels);
+    void finishBlock();
+
+  public:
+
+    static const int kMaxBlockFrames = 64;
+
+    ClipBlockBuffer();
+
+    // Sets the block length, or 0 to run the engine a frame at a time with
+    // no latency. Each change restarts the buffer with silence. Doesn't
+    // allocate.
+    void setBlockFrames(int frames);
+
+    // Drops whatever is queued, so that the next block's worth of output is
+    // silent rather than stale audio.
+    void reset() {
+        pos = 0;
+        silent = true;
+    }
+
+    // The latency, in frames.
+    int getBlockFrames() const {
+        return blockFrames;
+    }
+
+    // Queues one frame of `channels` samples with its level CV, which may be
+    // NULL, and writes out the frame that went in a block ago. Returns the
+    // number of channels written.
+    int process(
+        ClipEngine& engine,
+        const float* in_,
+        const float* levelCv_,
+        float* out_,
+        int channels);
+
+    // The same, for a bypassed module: the frame comes out a block later
+    // untouched, so that bypassing doesn't shift the signal in time. A block
+    // that fills while bypassed comes out untouched as a whole.
+    int bypass(const float* in_, float* out_, int channels);
+};
+
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,217 @@
+#pragma once
+
+// Filters and oversampling. This header does not depend on Rack.
+
+#include <cmath>
+
+#include "arc_kernels.hpp"
+
+namespace arc {
+namespace dsp {
+
+//--------------------------------------------------------------
+// Biquad
+//--------------------------------------------------------------
+
+// A port of rack::dsp::TBiquadFilter<T>, with the same arithmetic, so the
+// plugin sounds the same whether or not it runs inside Rack: float
+// coefficients, T state, Direct Form I.
+template <typename T> struct Biquad {
+
+    T x[2] = {};
+    T y[2] = {};
+
+    float b[3] = {1.0f, 0.0f, 0.0f};
+    float a[2] = {0.0f, 0.0f};
+
+    // f is the cutoff divided by the sample rate, and must be below 0.5.
+    void setLowpass(float f, float Q) {
+        float K = std::tan(M_PI * f);
+        float norm = 1.f / (1.f + K / Q + K * K);
+        b[0] = K * K * norm;
+        b[1] = 2.f * b[0];
+        b[2] = b[0];
+        a[0] = 2.f * (K * K - 1.f) * norm;
+        a[1] = (1.f - K / Q + K * K) * norm;
+    }
+
+    // Any other response, with a0 normalized to 1.
+    void setCoefficients(double b0, double b1, double b2, double a1, double a2) {
+        b[0] = b0;
+        b[1] = b1;
+        b[2] = b2;
+        a[0] = a1;
+        a[1] = a2;
+    }
+
+    T process(T in) {
+        T out = b[0] * in + b[1] * x[0] + b[2] * x[1] - a[0] * y[0] - a[1] * y[1];
+        x[1] = x[0];
+        x[0] = in;
+        y[1] = y[0];
+        y[0] = out;
+        return out;
+    }
+};
+
+//--------------------------------------------------------------
+// TwelvePoleLpf
+//--------------------------------------------------------------
+
+// Six Biquad<double>s in series, passing floats between them. Runs of
+// samples go through the cascade kernel, which filters them as a wavefront
+// when the run is long enough, with the same arithmetic.
+struct TwelvePoleLpf {
+
+  private:
+
+    static const int kFilters = 6;
+
+    CascadeState cascade;
+
+  public:
+
+    TwelvePoleLpf() {
+        cascade.sections = kFilters;
+    }
+
+    void setCutoff(float cutoff, float sampleRate) {
+
+        // https://www.earlevel.com/main/2016/09/29/cascading-filters/
+        // A local, so that it needs no out-of-line definition in C++11.
+        static const double Q[kFilters] = {
+            0.50431448, 0.54119610, 0.63023621, 0.82133982, 1.3065630, 3.8306488};
+
+        double fc = cutoff / sampleRate;
+
+        // Biquad's float coefficients, widened as its arithmetic widens them.
+        for (int i = 0; i < kFilters; i++) {
+            Biquad<double> filter;
+            filter.setLowpass(fc, Q[i]);
+            cascade.b0[i] = filter.b[0];
+            cascade.b1[i] = filter.b[1];
+            cascade.b2[i] = filter.b[2];
+            cascade.a1[i] = filter.a[0];
+            cascade.a2[i] = filter.a[1];
+        }
+    }
+
+    float process(float in) {
+        float out;
+        process(&in, &out, 1);
+        return out;
+    }
+
+    // Filters n samples, `stride` floats apart, from in to out, which may be
+    // the same buffer. A run too short for a wavefront, such as one frame's
+    // sub-samples, is filtered here instead, with the same arithmetic, where
+    // the six sections can be unrolled and nothing goes through the table.
+    void process(const float* in, float* out, int n, int stride = 1) {
+        if (n >= kMinWavefront) {
+            kernels().cascade(cascade, in, out, n, stride);
+            return;
+        }
+
+        for (int i = 0; i < n; i++) {
+            float v = in[i * stride];
+            for (int k = 0; k < kFilters; k++) {
+                double y = cascade.b0[k] * v + cascade.b1[k] * cascade.x0[k] +
+                           cascade.b2[k] * cascade.x1[k] - cascade.a1[k] * cascade.y0[k] -
+                           cascade.a2[k] * cascade.y1[k];
+                cascade.x1[k] = cascade.x0[k];
+                cascade.x0[k] = v;
+                cascade.y1[k] = cascade.y0[k];
+                cascade.y0[k] = y;
+                v = y;
+            }
+            out[i * stride] = v;
+        }
+    }
+
+    // Whether every section's last inputs and outputs are within tolerance
+    // of 0, so that silence in would give (nearly) silence out.
+    bool isSettled(double tolerance) const {
+        for (int i = 0; i < kFilters; i++) {
+            if (std::fabs(cascade.x0[i]) > tolerance || std::fabs(cascade.x1[i]) > tolerance ||
+                std::fabs(cascade.y0[i]) > tolerance || std::fabs(cascade.y1[i]) > tolerance) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void reset() {
+        for (int i = 0; i < kFilters; i++) {
+            cascade.x0[i] = cascade.x1[i] = cascade.y0[i] = cascade.y1[i] = 0.0;
+        }
+    }
+};
+
+//--------------------------------------------------------------
+// Oversample
+//--------------------------------------------------------------
+
+const int kMaxOversample = 16;
+
+struct Oversample {
+
+  private:
+
+    int oversample;
+
+    TwelvePoleLpf upLpf;
+    TwelvePoleLpf downLpf;
+
+  public:
+
+    Oversample(int oversample_) : oversample(oversample_) {
+    }
+
+    void onSampleRateChange(float sampleRate) {
+
+        float nyquist = sampleRate / 2.0f;
+        float oversampleRate = sampleRate * oversample;
+
+        upLpf.setCutoff(nyquist, oversampleRate);
+        downLpf.setCutoff(nyquist, oversampleRate);
+    }
+
+    bool isSettled(double tolerance) const {
+        return upLpf.isSettled(tolerance) && downLpf.isSettled(tolerance);
+    }
+
+    // Clears both filters, as if they had only ever seen silence.
+    void reset() {
+        upLpf.reset();
+        downLpf.reset();
+    }
+
+    // Upsamples `frames` samples, `inStride` floats apart, to
+    // frames * oversample sub-samples. Consecutive sub-samples are `stride`
+    // floats apart in the buffer, so several channels can share one
+    // interleaved buffer. The whole run goes through the filter at once.
+    void upsample(const float* in, int inStride, int frames, float* buffer, int stride) {
+
+        // Interpolate with zeros, and apply gain to compensate for filtering
+        for (int f = 0; f < frames; f++) {
+            float* sub = buffer + f * oversample * stride;
+            sub[0] = in[f * inStride] * oversample;
+            for (int i = 1; i < oversample; ++i) {
+                sub[i * stride] = 0.0f;
+            }
+        }
+        upLpf.process(buffer, buffer, frames * oversample, stride);
+    }
+
+    // The reverse of upsample(). Filters the buffer in place, and writes the
+    // first sub-sample of each frame, as it was before filtering, to out.
+    void downsample(float* buffer, int stride, int frames, float* out, int outStride) {
+        for (int f = 0; f < frames; f++) {
+            out[f * outStride] = buffer[f * oversample * stride];
+        }
+        downLpf.process(buffer, buffer, frames * oversample, stride);
+    }
+};
+
+} // namespace dsp
+} // namespace arc
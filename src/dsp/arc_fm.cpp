@@ -0,0 +1,32 @@
+#include "arc_fm.hpp"
+
+namespace arc {
+namespace dsp {
+
+static const float kZeros[kKernelWidth] = {};
+
+void FmEngine::processBlock(
+    const float* carrierPitch, float* modulatorPitch, int frames, int channels) {
+
+    const Kernels& k = kernels();
+
+    FmKernelArgs args;
+    args.ratio = ratio;
+    args.ratioCvAmount = ratioCvAmount;
+    args.offset = offset;
+    args.offsetCvAmount = offsetCvAmount;
+    args.quantizeRatio = quantizeRatio;
+
+    for (int f = 0; f < frames; f++) {
+        int base = f * channels;
+
+        args.carrierPitch = carrierPitch + base;
+        args.ratioCv = ratioCv ? ratioCv + base : kZeros;
+        args.offsetCv = offsetCv ? offsetCv + base : kZeros;
+
+        k.fmPitch(args, modulatorPitch + base, channels);
+    }
+}
+
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,35 @@
+#pragma once
+
+// The FM engine: turns a carrier pitch into a modulator pitch, from a ratio
+// and an offset in Hz, each with an optional per-channel CV. This header does
+// not depend on Rack.
+
+#include <cstddef>
+
+#include "arc_kernels.hpp"
+
+namespace arc {
+namespace dsp {
+
+class FmEngine {
+
+  public:
+
+    // Read by each processBlock().
+    float ratio = 1.0f;
+    float ratioCvAmount = 0.0f;
+    float offset = 0.0f; // 40 Hz per unit
+    float offsetCvAmount = 0.0f;
+    bool quantizeRatio = true;
+
+    // Per channel, laid out like the pitch, or NULL if unpatched.
+    const float* ratioCv = NULL;
+    const float* offsetCv = NULL;
+
+    // carrierPitch and modulatorPitch hold `frames` frames of `channels`
+    // interleaved V/Oct values.
+    void processBlock(const float* carrierPitch, float* modulatorPitch, int frames, int channels);
+};
+
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,36 @@
+#include "arc_gain.hpp"
+
+namespace arc {
+namespace dsp {
+
+void GainEngine::onSampleRateChange(float sampleRate) {
+    levelAmp.onSampleRateChange(sampleRate);
+    for (int ch = 0; ch < kKernelWidth; ch++) {
+        levelCvAmps[ch].onSampleRateChange(sampleRate);
+    }
+}
+
+void GainEngine::processBlock(const float* in, float* out, int frames, int channels) {
+
+    const Kernels& k = kernels();
+    float amps[kKernelWidth];
+
+    for (int f = 0; f < frames; f++) {
+        int base = f * channels;
+
+        float amp = levelAmp.next(muted ? kMinDb : level, coarse);
+        for (int ch = 0; ch < channels; ch++) {
+            amps[ch] = amp;
+            if (levelCv) {
+                float db = muted ? kMinDb : levelCvToDb(levelCv[base + ch]);
+                amps[ch] *= levelCvAmps[ch].next(db, coarse);
+            }
+        }
+
+        // hard clip
+        sum = k.gain(in + base, 1, amps, out + base, channels);
+    }
+}
+
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,41 @@
+#pragma once
+
+// The GAIN engine: a smoothed level with optional per-channel level CV,
+// hard clipped at +/-10V. This header does not depend on Rack.
+
+#include <cstddef>
+
+#include "arc_kernels.hpp"
+#include "arc_ramp.hpp"
+
+namespace arc {
+namespace dsp {
+
+class GainEngine {
+
+    Amplifier levelAmp;
+    Amplifier levelCvAmps[kKernelWidth];
+
+  public:
+
+    // Read by each processBlock().
+    float level = 0.0f; // in dB
+    bool muted = false;
+
+    // 0V to 10V per channel, laid out like the audio, or NULL if unpatched.
+    const float* levelCv = NULL;
+
+    // Use the coarse level law of the lowest quality tier.
+    bool coarse = false;
+
+    // The sum of every channel of the last frame.
+    float sum = 0.0f;
+
+    void onSampleRateChange(float sampleRate);
+
+    // in and out hold `frames` frames of `channels` interleaved samples.
+    void processBlock(const float* in, float* out, int frames, int channels);
+};
+
+} // namespace dsp
+} // namespace arc
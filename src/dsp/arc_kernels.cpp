@@ -0,0 +1,29 @@
+#include "arc_kernels.hpp"
+
+namespace arc {
+namespace dsp {
+
+static const Kernels* activeKernels = defaultKernels();
+
+static bool cpuHasAvx2() {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+void selectKernels(bool allowAvx2) {
+    activeKernels = defaultKernels();
+    if (allowAvx2 && avx2Kernels() && cpuHasAvx2()) {
+        activeKernels = avx2Kernels();
+    }
+}
+
+const Kernels& kernels() {
+    return *activeKernels;
+}
+
+} // namespace dsp
+} // namespace arc
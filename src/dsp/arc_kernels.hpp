@@ -0,0 +1,120 @@
+#pragma once
+
+// Vectorized inner loops shared by the modules.
+//
+// Every kernel processes up to PORT_MAX_CHANNELS (16) channels as two 8-wide
+// vectors. The gain and FM kernels never touch memory past the channel count,
+// so their buffers can be packed tightly, one frame after another. Each
+// kernel is built twice, once with the plugin's default flags and once with
+// AVX2 enabled, and selectKernels() picks one table at plugin init() based on
+// what the CPU supports. This header does not depend on Rack.
+
+#include "arc_shapers.hpp"
+
+namespace arc {
+namespace dsp {
+
+// The width of every buffer handed to a kernel.
+const int kKernelWidth = 16;
+
+// The length of each phase of the true-peak interpolation filter.
+const int kTruePeakTaps = 12;
+
+// The most sections a biquad cascade can have.
+const int kCascadeLanes = 8;
+
+// The wavefront spends a step filling and a step draining per section, so
+// the cascade kernel runs shorter runs through the sections one at a time.
+const int kMinWavefront = 16;
+
+// A cascade of Direct Form I biquads, one lane per section: the
+// coefficients, with a0 normalized to 1, and each section's last two inputs
+// and outputs. Lanes past `sections` are ignored.
+struct CascadeState {
+    int sections = 0;
+
+    double b0[kCascadeLanes] = {};
+    double b1[kCascadeLanes] = {};
+    double b2[kCascadeLanes] = {};
+    double a1[kCascadeLanes] = {};
+    double a2[kCascadeLanes] = {};
+
+    double x0[kCascadeLanes] = {};
+    double x1[kCascadeLanes] = {};
+    double y0[kCascadeLanes] = {};
+    double y1[kCascadeLanes] = {};
+};
+
+struct FmKernelArgs {
+    const float* carrierPitch;
+    const float* ratioCv;
+    const float* offsetCv;
+
+    float ratio;
+    float ratioCvAmount;
+    float offset;
+    float offsetCvAmount;
+    bool quantizeRatio;
+};
+
+struct Kernels {
+
+    const char* name;
+
+    // out[ch] = clamp(in[ch * inStride] * amp[ch], -10, 10) for each of the
+    // given channels, and returns their sum. An inStride of 0 applies a
+    // monophonic input to every channel.
+    float (*gain)(const float* in, int inStride, const float* amp, float* out, int channels);
+
+    // Like gain, but rather than clamping, each channel runs through the
+    // Cubic curve scaled to level off at +/-10V, with first-order
+    // antiderivative anti-aliasing. That delays the output by half a sample.
+    // previous holds each channel's last input to the curve, kKernelWidth
+    // floats; zero it to start from silence. Channels past the count are
+    // zeroed too, up to the next multiple of 8.
+    float (*saturatingGain)(
+        const float* in,
+        int inStride,
+        const float* amp,
+        float* out,
+        float* previous,
+        int channels);
+
+    // One waveshaper per Shape. Each shapes a run of n samples against a
+    // limit for each: x[i] = curve(x[i] / limit[i]) * limit[i]. It writes
+    // exactly n floats.
+    void (*shape[kShapesLen])(float* buffer, const float* limit, int n);
+
+    // Computes the FM modulator pitch for each channel from the carrier
+    // pitch, ratio and offset.
+    void (*fmPitch)(const FmKernelArgs& args, float* out, int channels);
+
+    // Interpolates a stereo signal 4x with the ITU-R BS.1770 filter, and
+    // writes only the largest magnitude of the four interpolated samples for
+    // each side to peaks[0] and peaks[1]. The history holds kTruePeakTaps
+    // frames, oldest first, of 8 floats each: the left sample in lanes 0-3,
+    // the right in lanes 4-7.
+    void (*truePeak)(const float* history, float* peaks);
+
+    // Runs n samples, `stride` floats apart, through each section of the
+    // cascade in turn, rounding to float between sections. in and out may be
+    // the same buffer. Long runs are scheduled as a wavefront: section k
+    // filters sample t - k while section k + 1 filters sample t - k - 1, so
+    // all the sections run at once, one per lane.
+    void (*cascade)(CascadeState& state, const float* in, float* out, int n, int stride);
+};
+
+// Tables built by the two kernel translation units. avx2Kernels() returns
+// NULL if the plugin was built without AVX2 support.
+const Kernels* defaultKernels();
+const Kernels* avx2Kernels();
+
+// Picks the fastest table the CPU supports, or the default table if
+// allowAvx2 is false. Call once from plugin init(), before any module runs.
+void selectKernels(bool allowAvx2 = true);
+
+// The table picked by selectKernels().
+const Kernels& kernels();
+
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,22 @@
+// Kernels built with -mavx2 (see the Makefile). Nothing in here may be called
+// until selectKernels() has confirmed that the CPU supports AVX2.
+
+#if defined(__AVX2__)
+#include "arc_kernels_impl.hpp"
+#else
+#include "arc_kernels.hpp"
+#endif
+
+namespace arc {
+namespace dsp {
+
+const Kernels* avx2Kernels() {
+#if defined(__AVX2__)
+    return &kKernels;
+#else
+    return 0;
+#endif
+}
+
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,14 @@
+// Kernels built with the plugin's default compiler flags. These run on every
+// CPU that Rack itself supports.
+
+#include "arc_kernels_impl.hpp"
+
+namespace arc {
+namespace dsp {
+
+const Kernels* defaultKernels() {
+    return &kKernels;
+}
+
+} // namespace dsp
+} // namespace arc
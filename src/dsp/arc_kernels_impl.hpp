@@ -0,0 +1,369 @@
+#pragma once
+
+// Kernel bodies for arc_kernels.hpp. Only the arc_kernels_*.cpp translation
+// units include this file, each with its own instruction set enabled.
+// Everything here has internal linkage, and it must not instantiate any
+// inline functions or templates from the standard library: the linker is free
+// to keep whichever copy it sees first, and an AVX2 copy would then leak into
+// code that runs on older CPUs.
+
+#include "arc_kernels.hpp"
+#include "arc_simd.hpp"
+
+namespace arc {
+namespace dsp {
+namespace {
+
+using simd::double_4;
+using simd::float_8;
+
+const float kFreqC4 = 261.6256f;
+
+inline int groupsOf8(int channels) {
+    return (channels + 7) >> 3;
+}
+
+//--------------------------------------------------------------
+// gain
+//--------------------------------------------------------------
+
+float gainKernel(const float* in, int inStride, const float* amp, float* out, int channels) {
+
+    float_8 sum = 0.0f;
+
+    for (int g = 0; g < groupsOf8(channels); g++) {
+        int ch = g * 8;
+        int n = channels - ch;
+
+        float_8 x = (inStride == 0) ? float_8(in[0]) : simd::loadPartial(in + ch, n);
+        float_8 v = clamp(x * simd::loadPartial(amp + ch, n), -10.0f, 10.0f);
+
+        simd::storePartial(v, out + ch, n);
+        sum += v;
+    }
+
+    return simd::hsum(sum);
+}
+
+//--------------------------------------------------------------
+// saturatingGain
+//--------------------------------------------------------------
+
+// The Cubic curve is scaled by kSaturation on both sides, so it keeps unity
+// gain for small signals and levels off at +/-10V.
+const float kSaturation = 15.0f;
+
+// Below this step, in curve units, the first-order ADAA difference quotient
+// is replaced by the curve at the midpoint, which matches it to well within
+// float precision there.
+const float kMinStep = 1.0e-3f;
+
+// (F(x) - F(x1)) / (x - x1), where F is the antiderivative of Cubic:
+// x^2/2 - x^4/12 inside +/-1, and 2/3 |x| - 1/4 outside. The part inside
+// +/-1 is factored by x - x1, so it loses no precision as the two approach
+// each other.
+inline float_8 cubicAdaa(float_8 x, float_8 x1) {
+    float_8 c = clamp(x, -1.0f, 1.0f);
+    float_8 c1 = clamp(x1, -1.0f, 1.0f);
+
+    float_8 inside = (c - c1) * (c + c1) * (0.5f - (c * c + c1 * c1) * (1.0f / 12.0f));
+    float_8 outside = ((simd::fabs(x) - simd::fabs(c)) - (simd::fabs(x1) - simd::fabs(c1)));
+
+    float_8 step = x - x1;
+    float_8 near = simd::fabs(step) < kMinStep;
+    float_8 quotient = (inside + outside * 0.6666667f) / ifelse(near, 1.0f, step);
+
+    // The quotient is an average of the curve, so it can only pass +/-2/3 by
+    // rounding.
+    quotient = clamp(quotient, -0.6666667f, 0.6666667f);
+    return ifelse(near, shape::Cubic::process((x + x1) * 0.5f), quotient);
+}
+
+float saturatingGainKernel(
+    const float* in,
+    int inStride,
+    const float* amp,
+    float* out,
+    float* previous,
+    int channels) {
+
+    float_8 sum = 0.0f;
+
+    for (int g = 0; g < groupsOf8(channels); g++) {
+        int ch = g * 8;
+        int n = channels - ch;
+
+        float_8 x = (inStride == 0) ? float_8(in[0]) : simd::loadPartial(in + ch, n);
+        x = x * simd::loadPartial(amp + ch, n) * (1.0f / kSaturation);
+
+        float_8 v = cubicAdaa(x, simd::loadPartial(previous + ch, n)) * kSaturation;
+        x.store(previous + ch);
+
+        simd::storePartial(v, out + ch, n);
+        sum += v;
+    }
+
+    return simd::hsum(sum);
+}
+
+//--------------------------------------------------------------
+// shape
+//--------------------------------------------------------------
+
+template <typename Shaper>
+void shapeKernel(float* buffer, const float* limit, int n) {
+
+    for (int i = 0; i < n; i += 8) {
+        int m = n - i;
+        float_8 lim = simd::loadPartial(limit + i, m);
+        float_8 x = simd::loadPartial(buffer + i, m);
+        simd::storePartial(Shaper::process(x / lim) * lim, buffer + i, m);
+    }
+}
+
+//--------------------------------------------------------------
+// fmPitch
+//--------------------------------------------------------------
+
+inline float_8 quantizeRatio(float_8 ratio) {
+    float_8 rounded = simd::floor(ratio + 0.5f);
+    float_8 q = ifelse(ratio < 0.75f, 0.5f, rounded);
+    q = ifelse(ratio < 0.375f, 0.25f, q);
+    return ifelse(ratio < 0.1875f, 0.125f, q);
+}
+
+void fmPitchKernel(const FmKernelArgs& args, float* out, int channels) {
+
+    for (int g = 0; g < groupsOf8(channels); g++) {
+        int ch = g * 8;
+        int n = channels - ch;
+
+        // ratio
+        float_8 ratioCv = simd::loadPartial(args.ratioCv + ch, n);
+        float_8 ratio = float_8(args.ratio) + ratioCv * args.ratioCvAmount;
+        if (args.quantizeRatio) {
+            ratio = quantizeRatio(ratio);
+        }
+
+        // offset, -200Hz to 200 Hz
+        float_8 offsetCv = simd::loadPartial(args.offsetCv + ch, n);
+        float_8 offset = float_8(args.offset) + offsetCv * args.offsetCvAmount;
+        offset = offset * 40.0f;
+
+        // frequency
+        float_8 carrierFreq = simd::exp2(simd::loadPartial(args.carrierPitch + ch, n)) * kFreqC4;
+        float_8 modulatorFreq = clamp(carrierFreq * ratio + offset, 20.0f, 20000.0f);
+
+        simd::storePartial(simd::log2(modulatorFreq / kFreqC4), out + ch, n);
+    }
+}
+
+//--------------------------------------------------------------
+// truePeak
+//--------------------------------------------------------------
+
+// The four phases of the 48-tap interpolation filter from ITU-R BS.1770-4,
+// Annex 2, one row per history frame, oldest first. Each row holds that
+// frame's tap for phases 0 to 3, once for the left lanes and once for the
+// right, so a single multiply-add per frame runs all eight filters.
+// clang-format off
+const float kTruePeakFilter[kTruePeakTaps][8] = {
+    {  -0.00830078125f, -0.0189208984375f, -0.0291748046875f,   0.001708984375f,
+       -0.00830078125f, -0.0189208984375f, -0.0291748046875f,   0.001708984375f},
+    {  0.014892578125f,  0.0330810546875f,      0.029296875f,   0.010986328125f,
+       0.014892578125f,  0.0330810546875f,      0.029296875f,   0.010986328125f},
+    { -0.026611328125f, -0.0582275390625f,    -0.0517578125f, -0.0196533203125f,
+      -0.026611328125f, -0.0582275390625f,    -0.0517578125f, -0.0196533203125f},
+    {  0.047607421875f,        0.1015625f,   0.089111328125f,      0.033203125f,
+       0.047607421875f,        0.1015625f,   0.089111328125f,      0.033203125f},
+    { -0.102294921875f, -0.2003173828125f,   -0.16650390625f, -0.0594482421875f,
+      -0.102294921875f, -0.2003173828125f,   -0.16650390625f, -0.0594482421875f},
+    {   0.97216796875f,    0.77978515625f,   0.465087890625f,  0.1373291015625f,
+        0.97216796875f,    0.77978515625f,   0.465087890625f,  0.1373291015625f},
+    { 0.1373291015625f,   0.465087890625f,    0.77978515625f,    0.97216796875f,
+      0.1373291015625f,   0.465087890625f,    0.77978515625f,    0.97216796875f},
+    {-0.0594482421875f,   -0.16650390625f, -0.2003173828125f,  -0.102294921875f,
+     -0.0594482421875f,   -0.16650390625f, -0.2003173828125f,  -0.102294921875f},
+    {     0.033203125f,   0.089111328125f,        0.1015625f,   0.047607421875f,
+          0.033203125f,   0.089111328125f,        0.1015625f,   0.047607421875f},
+    {-0.0196533203125f,    -0.0517578125f, -0.0582275390625f,  -0.026611328125f,
+     -0.0196533203125f,    -0.0517578125f, -0.0582275390625f,  -0.026611328125f},
+    {  0.010986328125f,      0.029296875f,  0.0330810546875f,   0.014892578125f,
+       0.010986328125f,      0.029296875f,  0.0330810546875f,   0.014892578125f},
+    {  0.001708984375f, -0.0291748046875f, -0.0189208984375f,   -0.00830078125f,
+       0.001708984375f, -0.0291748046875f, -0.0189208984375f,   -0.00830078125f},
+};
+// clang-format on
+
+void truePeakKernel(const float* history, float* peaks) {
+
+    float_8 sum = 0.0f;
+    for (int t = 0; t < kTruePeakTaps; t++) {
+        sum += float_8::load(kTruePeakFilter[t]) * float_8::load(history + t * 8);
+    }
+
+    float p[8];
+    simd::fabs(sum).store(p);
+
+    float left = p[0];
+    float right = p[4];
+    for (int i = 1; i < 4; i++) {
+        left = (p[i] > left) ? p[i] : left;
+        right = (p[4 + i] > right) ? p[4 + i] : right;
+    }
+    peaks[0] = left;
+    peaks[1] = right;
+}
+
+//--------------------------------------------------------------
+// cascade
+//--------------------------------------------------------------
+
+const double kCascadeLaneIndex[kCascadeLanes] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+void cascadeSerial(CascadeState& s, const float* in, float* out, int n, int stride) {
+    for (int i = 0; i < n; i++) {
+        float v = in[i * stride];
+        for (int k = 0; k < s.sections; k++) {
+            double y = s.b0[k] * v + s.b1[k] * s.x0[k] + s.b2[k] * s.x1[k] - s.a1[k] * s.y0[k] -
+                       s.a2[k] * s.y1[k];
+            s.x1[k] = s.x0[k];
+            s.x0[k] = v;
+            s.y1[k] = s.y0[k];
+            s.y0[k] = y;
+            v = y;
+        }
+        out[i * stride] = v;
+    }
+}
+
+// Four sections of the wavefront, one per lane.
+struct Sections {
+
+    double_4 b0, b1, b2, a1, a2;
+    double_4 x0, x1, y0, y1;
+
+    // Which section each lane holds.
+    double_4 index;
+
+    void load(const CascadeState& s, int first) {
+        b0 = double_4::load(s.b0 + first);
+        b1 = double_4::load(s.b1 + first);
+        b2 = double_4::load(s.b2 + first);
+        a1 = double_4::load(s.a1 + first);
+        a2 = double_4::load(s.a2 + first);
+        x0 = double_4::load(s.x0 + first);
+        x1 = double_4::load(s.x1 + first);
+        y0 = double_4::load(s.y0 + first);
+        y1 = double_4::load(s.y1 + first);
+        index = double_4::load(kCascadeLaneIndex + first);
+    }
+
+    void save(CascadeState& s, int first) const {
+        x0.store(s.x0 + first);
+        x1.store(s.x1 + first);
+        y0.store(s.y0 + first);
+        y1.store(s.y1 + first);
+    }
+
+    // Filters one sample per section, and returns the outputs rounded to
+    // float. When masked, only sections lo to hi have a sample; the others
+    // keep their state.
+    template <bool kMasked> double_4 step(double_4 x, int lo, int hi) {
+        double_4 y = b0 * x + b1 * x0 + b2 * x1 - a1 * y0 - a2 * y1;
+
+        if (kMasked) {
+            double_4 before = index < (double)lo;
+            double_4 off = simd::ifelse(before, before, index > (double)hi);
+            x1 = simd::ifelse(off, x1, x0);
+            x0 = simd::ifelse(off, x0, x);
+            y1 = simd::ifelse(off, y1, y0);
+            y0 = simd::ifelse(off, y0, y);
+        } else {
+            x1 = x0;
+            x0 = x;
+            y1 = y0;
+            y0 = y;
+        }
+        return simd::roundToFloat(y);
+    }
+};
+
+// All eight sections. Section 0 reads the input, and each other section
+// reads what the one before it passed on at the last step.
+struct Wavefront {
+
+    Sections first, second;
+    double_4 passedFirst = 0.0, passedSecond = 0.0;
+    int tail;
+
+    template <bool kMasked> float step(float input, int lo = 0, int hi = 0) {
+        double_4 x = simd::slide(input, passedFirst);
+        double_4 y = simd::slide(passedFirst, passedSecond);
+        passedFirst = first.step<kMasked>(x, lo, hi);
+        passedSecond = second.step<kMasked>(y, lo, hi);
+
+        double out[kCascadeLanes];
+        passedFirst.store(out);
+        passedSecond.store(out + 4);
+        return (float)out[tail];
+    }
+};
+
+void cascadeKernel(CascadeState& s, const float* in, float* out, int n, int stride) {
+
+    if (n < kMinWavefront) {
+        cascadeSerial(s, in, out, n, stride);
+        return;
+    }
+
+    Wavefront w;
+    w.first.load(s, 0);
+    w.second.load(s, 4);
+    w.tail = s.sections - 1;
+
+    // Filling: section k starts on step k.
+    int t = 0;
+    for (; t < w.tail; t++) {
+        w.step<true>(in[t * stride], 0, t);
+    }
+    for (; t < n; t++) {
+        out[(t - w.tail) * stride] = w.step<false>(in[t * stride]);
+    }
+    // Draining: section k finishes on step n - 1 + k.
+    for (; t < n + w.tail; t++) {
+        out[(t - w.tail) * stride] = w.step<true>(0.0f, t - n + 1, w.tail);
+    }
+
+    w.first.save(s, 0);
+    w.second.save(s, 4);
+}
+
+//--------------------------------------------------------------
+// table
+//--------------------------------------------------------------
+
+const Kernels kKernels = {
+#if defined(ARC_SIMD_AVX2)
+    "AVX2",
+#elif defined(ARC_SIMD_SSE2)
+    "SSE2",
+#else
+    "scalar",
+#endif
+    gainKernel,
+    saturatingGainKernel,
+    {
+        shapeKernel<shape::Cubic>,
+        shapeKernel<shape::Tanh>,
+        shapeKernel<shape::Asymmetric>,
+        shapeKernel<shape::Hard>,
+    },
+    fmPitchKernel,
+    truePeakKernel,
+    cascadeKernel,
+};
+
+} // namespace
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,157 @@
+#include "arc_loudness.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace arc {
+namespace dsp {
+
+// BS.1770 defines loudness as -0.691 + 10 log10 of the summed mean squares,
+// where -0.691 cancels the K-weighting's gain at 1kHz.
+static const double kOffset = -0.691;
+
+static double energyToLufs(double energy) {
+    return (energy > 0.0) ? kOffset + 10.0 * std::log10(energy) : -INFINITY;
+}
+
+static double lufsToEnergy(double lufs) {
+    return std::pow(10.0, (lufs - kOffset) / 10.0);
+}
+
+Loudness::Loudness() {
+    onSampleRateChange(44100.0f);
+}
+
+void Loudness::onSampleRateChange(float sampleRate) {
+
+    // The two stages of the K-weighting filter, designed for any sample rate
+    // the same way libebur128 does. At 48kHz they match the coefficients
+    // printed in BS.1770.
+
+    // a high shelf, +4dB above 2kHz, for the head
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double Q = 0.7071752369554196;
+    double K = std::tan(M_PI * f0 / sampleRate);
+    double vh = std::pow(10.0, gain / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + K / Q + K * K;
+    Biquad<double> shelf;
+    shelf.setCoefficients(
+        (vh + vb * K / Q + K * K) / a0,
+        2.0 * (K * K - vh) / a0,
+        (vh - vb * K / Q + K * K) / a0,
+        2.0 * (K * K - 1.0) / a0,
+        (1.0 - K / Q + K * K) / a0);
+
+    // the "revised low-frequency B" highpass
+    f0 = 38.13547087602444;
+    Q = 0.5003270373238773;
+    K = std::tan(M_PI * f0 / sampleRate);
+    a0 = 1.0 + K / Q + K * K;
+    Biquad<double> highpass;
+    highpass.setCoefficients(1.0, -2.0, 1.0, 2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0);
+
+    leftShelf = rightShelf = shelf;
+    leftHighpass = rightHighpass = highpass;
+
+    blockFrames = std::max((int)std::round(sampleRate / 10.0f), 1);
+    blockCount = 0;
+    blockSum = 0.0;
+
+    for (double& b : blocks) {
+        b = 0.0;
+    }
+    blockIndex = 0;
+    momentarySum = 0.0;
+    shortTermSum = 0.0;
+    momentary.store(kSilence, std::memory_order_relaxed);
+    shortTerm.store(kSilence, std::memory_order_relaxed);
+
+    clearIntegrated();
+}
+
+void Loudness::clearIntegrated() {
+    for (uint32_t& count : histogram) {
+        count = 0;
+    }
+    gatedSum = 0.0;
+    gatedCount = 0;
+    blocksSeen = 0;
+    integrated.store(kSilence, std::memory_order_relaxed);
+}
+
+void Loudness::endBlock() {
+
+    if (resetRequested.exchange(false, std::memory_order_relaxed)) {
+        clearIntegrated();
+    }
+
+    double energy = blockSum / blockFrames;
+    blockCount = 0;
+    blockSum = 0.0;
+
+    // The block leaving the momentary window, and the one leaving the
+    // short-term window, which is about to be overwritten.
+    int momentaryOut = (blockIndex + kShortTermBlocks - kMomentaryBlocks) % kShortTermBlocks;
+    momentarySum += energy - blocks[momentaryOut];
+    shortTermSum += energy - blocks[blockIndex];
+    blocks[blockIndex] = energy;
+    blockIndex = (blockIndex + 1) % kShortTermBlocks;
+    blocksSeen++;
+
+    // Re-add the sums from scratch each time the ring wraps, so rounding
+    // can't pile up over a long session.
+    if (blockIndex == 0) {
+        momentarySum = 0.0;
+        shortTermSum = 0.0;
+        for (int i = 0; i < kShortTermBlocks; i++) {
+            shortTermSum += blocks[i];
+            if (i >= kShortTermBlocks - kMomentaryBlocks) {
+                momentarySum += blocks[i];
+            }
+        }
+    }
+
+    double momentaryEnergy = std::max(momentarySum, 0.0) / kMomentaryBlocks;
+    double momentaryLufs = energyToLufs(momentaryEnergy);
+    double shortTermLufs = energyToLufs(std::max(shortTermSum, 0.0) / kShortTermBlocks);
+    momentary.store(std::max(momentaryLufs, (double)kSilence), std::memory_order_relaxed);
+    shortTerm.store(std::max(shortTermLufs, (double)kSilence), std::memory_order_relaxed);
+
+    // Each block completes a 400ms gating block that overlaps the last one
+    // by 75%, once enough blocks have passed since the last reset to fill
+    // one.
+    if (blocksSeen >= kMomentaryBlocks && momentaryLufs > kSilence) {
+        int bin = (int)((momentaryLufs - kSilence) / kBinWidth);
+        histogram[std::min(bin, kBins - 1)]++;
+        gatedSum += momentaryEnergy;
+        gatedCount++;
+        integrated.store(gate(), std::memory_order_relaxed);
+    }
+}
+
+// The relative gate sits 10 LU below the loudness of everything above the
+// absolute gate. Integrated loudness is the loudness of the gating blocks
+// above both gates, each taken at the energy of its bin's center.
+float Loudness::gate() const {
+
+    double relative = energyToLufs(gatedSum / gatedCount) - 10.0;
+    int first = std::max((int)std::ceil((relative - kSilence) / kBinWidth - 0.5), 0);
+
+    double sum = 0.0;
+    uint32_t count = 0;
+    double binEnergy = lufsToEnergy(kSilence + (first + 0.5) * kBinWidth);
+    double step = lufsToEnergy(kBinWidth) / lufsToEnergy(0.0);
+
+    for (int b = first; b < kBins; b++) {
+        sum += histogram[b] * binEnergy;
+        count += histogram[b];
+        binEnergy *= step;
+    }
+
+    return (count > 0) ? std::max(energyToLufs(sum / count), (double)kSilence) : kSilence;
+}
+
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,113 @@
+#pragma once
+
+// Loudness metering after ITU-R BS.1770 and EBU R128: momentary (400ms),
+// short-term (3s) and gated integrated loudness of a stereo signal, in LUFS.
+//
+// The only per-sample work is the K-weighting filters and a sum of squares.
+// Everything else happens once per 100ms block: the momentary and short-term
+// windows are running sums over a ring of block energies, and integrated
+// loudness gates a histogram of momentary loudness rather than every block
+// since the last reset. Readings are published through atomics for the UI
+// thread. This header does not depend on Rack.
+
+#include <atomic>
+#include <cstdint>
+
+#include "arc_filter.hpp"
+
+namespace arc {
+namespace dsp {
+
+class Loudness {
+
+  public:
+
+    // The absolute gate. Every reading at or below it means silence, or no
+    // reading yet.
+    static constexpr float kSilence = -70.0f;
+
+    Loudness();
+
+    Loudness(const Loudness&) = delete;
+    Loudness& operator=(const Loudness&) = delete;
+
+    // Starts over.
+    void onSampleRateChange(float sampleRate);
+
+    // Audio thread, once per sample. 1.0 is full scale.
+    void process(float left, float right) {
+        double l = leftShelf.process(left);
+        double r = rightShelf.process(right);
+        l = leftHighpass.process(l);
+        r = rightHighpass.process(r);
+        blockSum += l * l + r * r;
+
+        if (++blockCount == blockFrames) {
+            endBlock();
+        }
+    }
+
+    // Any thread. Integrated loudness starts over at the next block.
+    void resetIntegrated() {
+        resetRequested.store(true, std::memory_order_relaxed);
+    }
+
+    // Any thread.
+    float getMomentary() const {
+        return momentary.load(std::memory_order_relaxed);
+    }
+
+    float getShortTerm() const {
+        return shortTerm.load(std::memory_order_relaxed);
+    }
+
+    float getIntegrated() const {
+        return integrated.load(std::memory_order_relaxed);
+    }
+
+  private:
+
+    static const int kMomentaryBlocks = 4;
+    static const int kShortTermBlocks = 30;
+
+    // A tenth of an LU per bin, from the absolute gate up to +10 LUFS.
+    static constexpr float kBinWidth = 0.1f;
+    static const int kBins = 800;
+
+    Biquad<double> leftShelf;
+    Biquad<double> rightShelf;
+    Biquad<double> leftHighpass;
+    Biquad<double> rightHighpass;
+
+    int blockFrames = 4410;
+    int blockCount = 0;
+    double blockSum = 0.0;
+
+    // The mean square of each of the last kShortTermBlocks blocks, and the
+    // running sums of the latest few.
+    double blocks[kShortTermBlocks];
+    int blockIndex = 0;
+    double momentarySum = 0.0;
+    double shortTermSum = 0.0;
+
+    // Every 400ms gating block above the absolute gate since the last reset:
+    // how many fell in each bin, plus their exact energy, for the relative
+    // gate.
+    int blocksSeen = 0;
+    uint32_t histogram[kBins];
+    double gatedSum = 0.0;
+    uint32_t gatedCount = 0;
+
+    std::atomic<bool> resetRequested{false};
+
+    std::atomic<float> momentary{kSilence};
+    std::atomic<float> shortTerm{kSilence};
+    std::atomic<float> integrated{kSilence};
+
+    void endBlock();
+    void clearIntegrated();
+    float gate() const;
+};
+
+} // namespace dsp
+} // namespace arc
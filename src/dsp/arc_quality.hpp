@@ -0,0 +1,144 @@
+#pragma once
+
+// Quality tiers, and the governor that picks one from the engine load.
+//
+// Each tier keeps the savings of the tiers above it, and gives up one more
+// thing, most expensive first. The governor steps down a tier whenever the
+// load stays high for a while, and back up only once it has stayed low for
+// much longer, so it doesn't oscillate around a threshold. This header does
+// not depend on Rack.
+
+#include <atomic>
+
+namespace arc {
+namespace dsp {
+
+enum Tier {
+    kTierFull,
+
+    // CLIP oversamples 2x instead of 4x.
+    kTierOversample,
+
+    // Meters only look at the peak of every kMeterDivision samples.
+    kTierMeters,
+
+    // CV inputs are read every kCvDivision samples, and held in between.
+    // The level and pan ramps still smooth every sample.
+    kTierControlRate,
+
+    // Level and pan use coarse lookup tables instead of pow(), sin() and
+    // cos().
+    kTierTables,
+
+    kTiersLen
+};
+
+const int kMeterDivision = 16;
+const int kCvDivision = 8;
+
+inline int clipOversample(int tier) {
+    return (tier >= kTierOversample) ? 2 : 4;
+}
+
+inline int meterDivision(int tier) {
+    return (tier >= kTierMeters) ? kMeterDivision : 1;
+}
+
+inline int cvDivision(int tier) {
+    return (tier >= kTierControlRate) ? kCvDivision : 1;
+}
+
+inline bool coarseTables(int tier) {
+    return tier >= kTierTables;
+}
+
+// What the tier gives up, on top of the tiers above it.
+inline const char* tierName(int tier) {
+    // clang-format off
+    switch (tier) {
+        case kTierOversample:  return "CLIP at 2x oversampling";
+        case kTierMeters:      return "Slower meters";
+        case kTierControlRate: return "Control rate CV";
+        case kTierTables:      return "Coarse level and pan";
+        default:               return "Full quality";
+    }
+    // clang-format on
+}
+
+//--------------------------------------------------------------
+// Governor
+//--------------------------------------------------------------
+
+class Governor {
+
+    std::atomic<int> tier{kTierFull};
+
+    // Held by whichever thread is in update().
+    std::atomic<bool> updating{false};
+
+    // When the load crossed into the high or low zone, or -1 if it isn't
+    // there.
+    double highSince = -1.0;
+    double lowSince = -1.0;
+
+  public:
+
+    // The load is the fraction of the engine's real-time budget in use.
+    static constexpr float kHighLoad = 0.85f;
+    static constexpr float kLowLoad = 0.6f;
+
+    // How long, in seconds, the load must stay in a zone before the tier
+    // changes. Each change restarts the clock, so the new tier gets time to
+    // show its effect.
+    static constexpr double kStepDownHold = 0.5;
+    static constexpr double kStepUpHold = 4.0;
+
+    // Read by the audio thread.
+    int getTier() const {
+        return tier.load(std::memory_order_relaxed);
+    }
+
+    // Called as often as the caller likes, from any thread. Rack may run
+    // modules on several threads, so a call made while another is under
+    // way is dropped; the governor only acts on how long the load stays
+    // high or low, so it misses nothing. `now` is in seconds.
+    void update(double now, float load) {
+        if (updating.exchange(true, std::memory_order_acquire)) {
+            return;
+        }
+        step(now, load);
+        updating.store(false, std::memory_order_release);
+    }
+
+  private:
+
+    void step(double now, float load) {
+        int t = getTier();
+
+        if (load > kHighLoad) {
+            lowSince = -1.0;
+            if (highSince < 0.0) {
+                highSince = now;
+            }
+            if (now - highSince >= kStepDownHold && t < kTiersLen - 1) {
+                tier.store(t + 1, std::memory_order_relaxed);
+                highSince = now;
+            }
+        } else if (load < kLowLoad) {
+            highSince = -1.0;
+            if (lowSince < 0.0) {
+                lowSince = now;
+            }
+            if (now - lowSince >= kStepUpHold && t > kTierFull) {
+                tier.store(t - 1, std::memory_order_relaxed);
+                lowSince = now;
+            }
+        } else {
+            highSince = -1.0;
+            lowSince = -1.0;
+        }
+    }
+};
+
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,233 @@
+#pragma once
+
+// Parameter smoothing shared by the engines. This header does not depend on
+// Rack.
+
+#include <cassert>
+#include <cmath>
+
+namespace arc {
+namespace dsp {
+
+// The range of the level controls and level CVs.
+constexpr float kMinDb = -60.0f;
+constexpr float kMaxDb = 12.0f;
+
+template <typename T> T decibelsToAmplitude(T db) {
+    if (db <= -60.0f) {
+        return 0.0f;
+    }
+    return std::pow(10, db / 20);
+}
+
+// Maps a 0V to 10V level CV onto kMinDb to kMaxDb, the same way
+// rack::math::rescale() would.
+inline float levelCvToDb(float v) {
+    return kMinDb + v / 10.0f * (kMaxDb - kMinDb);
+}
+
+//--------------------------------------------------------------
+// GainTables
+//--------------------------------------------------------------
+
+// Coarse, nearest-entry versions of the level and pan laws, for the lowest
+// quality tier: a quarter dB per entry from kMinDb to +36dB, and 1/64 of the
+// pan range per entry.
+class GainTables {
+
+    static const int kDbSteps = 4;
+    static const int kDbEntries = (36 - (int)kMinDb) * kDbSteps + 1;
+    static const int kPanSteps = 64;
+    static const int kPanEntries = 2 * kPanSteps + 1;
+
+    float amps[kDbEntries];
+    float lefts[kPanEntries];
+    float rights[kPanEntries];
+
+    static int index(float x, int entries) {
+        int i = (int)(x + 0.5f);
+        return (i < 0) ? 0 : ((i >= entries) ? entries - 1 : i);
+    }
+
+  public:
+
+    GainTables();
+
+    float amplitude(float db) const {
+        return amps[index((db - kMinDb) * kDbSteps, kDbEntries)];
+    }
+
+    float left(float pan) const {
+        return lefts[index((pan + 1.0f) * kPanSteps, kPanEntries)];
+    }
+
+    float right(float pan) const {
+        return rights[index((pan + 1.0f) * kPanSteps, kPanEntries)];
+    }
+};
+
+// Built on first use. Call it once from plugin init(), so that first use
+// isn't on the audio thread.
+inline const GainTables& gainTables() {
+    static const GainTables tables;
+    return tables;
+}
+
+//--------------------------------------------------------------
+// LinearRamp
+//--------------------------------------------------------------
+
+class LinearRamp {
+
+    float sampleRate = 1.0f;
+    float time = 1.0f; // in seconds
+    float divisor = 1.0f;
+
+    float target = 0.0f;
+    float increment = 0.0f;
+    float value = 0.0f;
+
+    void recalc() {
+        divisor = 1.0f / (sampleRate * time);
+    }
+
+  public:
+
+    void onSampleRateChange(float sampleRate_) {
+        assert(sampleRate_ > 0.0f);
+        sampleRate = sampleRate_;
+        recalc();
+    }
+
+    void setTime(float time_ /* in seconds */) {
+        assert(time_ > 0.0f);
+        time = time_;
+        recalc();
+    }
+
+    float next(float target_) {
+
+        // done already
+        if (target_ == value) {
+            return value;
+        }
+
+        // new target
+        if (target != target_) {
+            target = target_;
+            increment = (target - value) * divisor;
+        }
+
+        // increment the value
+        bool rising = (target > value);
+        value += increment;
+
+        // rising
+        if (rising) {
+            if (value > target) {
+                value = target;
+            }
+        }
+        // falling
+        else {
+            if (value < target) {
+                value = target;
+            }
+        }
+
+        return value;
+    }
+};
+
+//--------------------------------------------------------------
+// Amplifier
+//--------------------------------------------------------------
+
+class Amplifier {
+
+    static constexpr float kRampTime = 0.005f;
+    arc::dsp::LinearRamp ramp;
+
+    float db = -60.0f;
+    float amp = 0.0f;
+    bool coarse = false;
+
+public:
+
+    void onSampleRateChange(float sampleRate) {
+        ramp.onSampleRateChange(sampleRate);
+        ramp.setTime(kRampTime);
+    }
+
+    // If coarse_ is true, the level law comes from gainTables().
+    float next(float v, bool coarse_ = false) {
+        v = ramp.next(v);
+        if (db == v && coarse == coarse_) {
+            return amp;
+        }
+
+        db = v;
+        coarse = coarse_;
+        amp = coarse ? gainTables().amplitude(db) : decibelsToAmplitude(db);
+        return amp;
+    }
+};
+
+//--------------------------------------------------------------
+// Panner
+//--------------------------------------------------------------
+
+class Panner {
+
+    static constexpr float kRampTime = 0.005f;
+    arc::dsp::LinearRamp ramp;
+
+    float pan = 0.0f;
+    bool coarse = false;
+
+public:
+
+    float left = 0.7071068f;
+    float right = 0.7071068f;
+
+    void onSampleRateChange(float sampleRate) {
+        ramp.onSampleRateChange(sampleRate);
+        ramp.setTime(kRampTime);
+    }
+
+    // Must be wthin [-1.0, 1.0]. If coarse_ is true, the pan law comes
+    // from gainTables().
+    void next(float v, bool coarse_ = false) {
+        v = ramp.next(v);
+        if (pan == v && coarse == coarse_) {
+            return;
+        }
+
+        pan = v;
+        coarse = coarse_;
+
+        if (coarse) {
+            left = gainTables().left(pan);
+            right = gainTables().right(pan);
+            return;
+        }
+
+        float lr = (pan + 1.0f) * 0.125f;
+        left = cosf(2.0f * M_PI * lr);
+        right = sinf(2.0f * M_PI * lr);
+    }
+};
+
+inline GainTables::GainTables() {
+    for (int i = 0; i < kDbEntries; i++) {
+        amps[i] = decibelsToAmplitude(kMinDb + (float)i / kDbSteps);
+    }
+    for (int i = 0; i < kPanEntries; i++) {
+        float lr = (float)i / kPanSteps * 0.125f;
+        lefts[i] = cosf(2.0f * M_PI * lr);
+        rights[i] = sinf(2.0f * M_PI * lr);
+    }
+}
+
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,132 @@
+#pragma once
+
+// Waveshaping curves.
+//
+// Each curve is a struct with a static process() template that works on
+// float, rack::simd::float_4 and arc::simd::float_8 alike, so a loop can be
+// instantiated once per curve and stay branch-free. All curves have unity
+// gain for small signals and start saturating as |x| approaches 1.
+//
+// This header does not depend on Rack, so the kernels can use it too.
+
+namespace arc {
+namespace dsp {
+
+enum Shape { kCubic, kTanh, kAsymmetric, kHard, kShapesLen };
+
+// Scalar versions of the vector helpers; the vector types find theirs by
+// argument dependent lookup. NaNs are handled like minps/maxps: if either
+// argument is NaN, the result is b.
+inline float fmin(float a, float b) {
+    return a < b ? a : b;
+}
+
+inline float fmax(float a, float b) {
+    return a > b ? a : b;
+}
+
+namespace shape {
+
+//--------------------------------------------------------------
+// Cubic
+//--------------------------------------------------------------
+
+// https://www.kvraudio.com/forum/viewtopic.php?p=2779936&sid=e1e44d1b6ec3fd37f76e4a8ca1ed422a#p2779936
+// Saturates at +/- 2/3.
+struct Cubic {
+
+    static const char* name() {
+        return "Cubic";
+    }
+
+    template <typename T> static T process(T x) {
+
+        // Hard Clip: clamp(x, -1, 1)
+        x = fmin(fmax(x, T(-1.0f)), T(1.0f));
+
+        // Soft Clip: Simple f(x) = 1.5x - 0.5x^3 waveshaper
+        x = x * T(1.5f) - x * x * x * T(0.5f);
+
+        // Remove the introduced gain
+        return x * T(0.6666667f);
+    }
+};
+
+//--------------------------------------------------------------
+// Tanh
+//--------------------------------------------------------------
+
+// 2/3 tanh(1.5x), with tanh replaced by its [3/2] Pade approximant, which
+// meets +/-1 exactly at +/-3. Saturates at +/- 2/3 like Cubic, but more
+// gently.
+struct Tanh {
+
+    static const char* name() {
+        return "Tanh";
+    }
+
+    template <typename T> static T process(T x) {
+        x = fmin(fmax(x * T(1.5f), T(-3.0f)), T(3.0f));
+        T x2 = x * x;
+        return x * (x2 + T(27.0f)) / (x2 * T(9.0f) + T(27.0f)) * T(0.6666667f);
+    }
+};
+
+//--------------------------------------------------------------
+// Asymmetric
+//--------------------------------------------------------------
+
+// The cubic curve, biased off center so that positive and negative swings
+// saturate differently, which adds even harmonics. The bias is subtracted
+// back out so silence stays at 0V, and the slope at 0 is scaled back to 1.
+// Saturates at about +0.45 and -0.97.
+struct Asymmetric {
+
+    static const char* name() {
+        return "Asymmetric";
+    }
+
+    static constexpr float kBias = 0.25f;
+
+    template <typename T> static T process(T x) {
+        // c(kBias), and 1 / c'(kBias), for c(x) = x - x^3 / 3
+        const float kOffset = kBias - kBias * kBias * kBias * 0.3333333f;
+        const float kGain = 1.0f / (1.0f - kBias * kBias);
+
+        x = fmin(fmax(x + T(kBias), T(-1.0f)), T(1.0f));
+        x = x - x * x * x * T(0.3333333f);
+        return (x - T(kOffset)) * T(kGain);
+    }
+};
+
+//--------------------------------------------------------------
+// Hard
+//--------------------------------------------------------------
+
+// Plain clipping at +/- 2/3, to match the ceiling of Cubic.
+struct Hard {
+
+    static const char* name() {
+        return "Hard";
+    }
+
+    template <typename T> static T process(T x) {
+        return fmin(fmax(x, T(-0.6666667f)), T(0.6666667f));
+    }
+};
+
+} // namespace shape
+
+inline const char* shapeName(int s) {
+    // clang-format off
+    switch (s) {
+        case kTanh:       return shape::Tanh::name();
+        case kAsymmetric: return shape::Asymmetric::name();
+        case kHard:       return shape::Hard::name();
+        default:          return shape::Cubic::name();
+    }
+    // clang-format on
+}
+
+} // namespace dsp
+} // namespace arc
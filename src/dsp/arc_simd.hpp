@@ -0,0 +1,610 @@
+#pragma once
+
+// An 8-wide float vector, and a 4-wide double vector, for the kernels in
+// arc_kernels_impl.hpp.
+//
+// This header does not depend on Rack. The backend is picked from the
+// compiler flags of the including translation unit: AVX2 uses one __m256 (or
+// __m256d), SSE2 uses a pair of __m128 (or __m128d), and anything else falls
+// back to plain arrays that the compiler is free to auto-vectorize. Each
+// backend lives in its own inline namespace, so translation units built with
+// different flags never share (and never accidentally link against) each
+// other's definitions.
+
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ARC_SIMD_AVX2 1
+#define ARC_SIMD_BACKEND avx2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ARC_SIMD_SSE2 1
+#define ARC_SIMD_BACKEND sse2
+#else
+#include <math.h>
+#define ARC_SIMD_SCALAR 1
+#define ARC_SIMD_BACKEND scalar
+#endif
+
+namespace arc {
+namespace simd {
+inline namespace ARC_SIMD_BACKEND {
+
+#if defined(ARC_SIMD_AVX2)
+
+//--------------------------------------------------------------
+// float_8: AVX2
+//--------------------------------------------------------------
+
+struct float_8 {
+
+    __m256 v;
+
+    float_8() {
+    }
+
+    float_8(__m256 v_) : v(v_) {
+    }
+
+    float_8(float x) : v(_mm256_set1_ps(x)) {
+    }
+
+    static float_8 load(const float* p) {
+        return _mm256_loadu_ps(p);
+    }
+
+    void store(float* p) const {
+        _mm256_storeu_ps(p, v);
+    }
+
+    // Lane i holds i.
+    static float_8 lanes() {
+        return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    }
+};
+
+// clang-format off
+inline float_8 operator+(float_8 a, float_8 b) { return _mm256_add_ps(a.v, b.v); }
+inline float_8 operator-(float_8 a, float_8 b) { return _mm256_sub_ps(a.v, b.v); }
+inline float_8 operator*(float_8 a, float_8 b) { return _mm256_mul_ps(a.v, b.v); }
+inline float_8 operator/(float_8 a, float_8 b) { return _mm256_div_ps(a.v, b.v); }
+
+inline float_8 operator<(float_8 a, float_8 b)  { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+inline float_8 operator>(float_8 a, float_8 b)  { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+inline float_8 operator==(float_8 a, float_8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+
+inline float_8 fmin(float_8 a, float_8 b) { return _mm256_min_ps(a.v, b.v); }
+inline float_8 fmax(float_8 a, float_8 b) { return _mm256_max_ps(a.v, b.v); }
+inline float_8 fabs(float_8 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+inline float_8 floor(float_8 a) { return _mm256_floor_ps(a.v); }
+// clang-format on
+
+// Lanes where mask is set take a, the others take b.
+inline float_8 ifelse(float_8 mask, float_8 a, float_8 b) {
+    return _mm256_blendv_ps(b.v, a.v, mask.v);
+}
+
+// Sums the lanes in a fixed order that every backend reproduces.
+inline float hsum(float_8 a) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+    __m128 t = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    return _mm_cvtss_f32(_mm_add_ss(t, _mm_shuffle_ps(t, t, 1)));
+}
+
+// x * 2^n, for integral n in [-126, 127].
+inline float_8 ldexp(float_8 x, float_8 n) {
+    __m256i e = _mm256_add_epi32(_mm256_cvttps_epi32(n.v), _mm256_set1_epi32(127));
+    return _mm256_mul_ps(x.v, _mm256_castsi256_ps(_mm256_slli_epi32(e, 23)));
+}
+
+// Splits positive normal x into a mantissa in [0.5, 1) and an exponent.
+inline float_8 frexp(float_8 x, float_8* e) {
+    __m256i i = _mm256_castps_si256(x.v);
+    __m256i biased = _mm256_srli_epi32(i, 23);
+    *e = _mm256_cvtepi32_ps(_mm256_sub_epi32(biased, _mm256_set1_epi32(126)));
+    i = _mm256_and_si256(i, _mm256_set1_epi32(0x007fffff));
+    i = _mm256_or_si256(i, _mm256_set1_epi32(0x3f000000));
+    return _mm256_castsi256_ps(i);
+}
+
+#elif defined(ARC_SIMD_SSE2)
+
+//--------------------------------------------------------------
+// float_8: SSE2
+//--------------------------------------------------------------
+
+struct float_8 {
+
+    __m128 lo;
+    __m128 hi;
+
+    float_8() {
+    }
+
+    float_8(__m128 lo_, __m128 hi_) : lo(lo_), hi(hi_) {
+    }
+
+    float_8(float x) : lo(_mm_set1_ps(x)), hi(_mm_set1_ps(x)) {
+    }
+
+    static float_8 load(const float* p) {
+        return float_8(_mm_loadu_ps(p), _mm_loadu_ps(p + 4));
+    }
+
+    void store(float* p) const {
+        _mm_storeu_ps(p, lo);
+        _mm_storeu_ps(p + 4, hi);
+    }
+
+    // Lane i holds i.
+    static float_8 lanes() {
+        return float_8(_mm_setr_ps(0, 1, 2, 3), _mm_setr_ps(4, 5, 6, 7));
+    }
+};
+
+// clang-format off
+inline float_8 operator+(float_8 a, float_8 b) { return float_8(_mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi)); }
+inline float_8 operator-(float_8 a, float_8 b) { return float_8(_mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi)); }
+inline float_8 operator*(float_8 a, float_8 b) { return float_8(_mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi)); }
+inline float_8 operator/(float_8 a, float_8 b) { return float_8(_mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi)); }
+
+inline float_8 operator<(float_8 a, float_8 b)  { return float_8(_mm_cmplt_ps(a.lo, b.lo), _mm_cmplt_ps(a.hi, b.hi)); }
+inline float_8 operator>(float_8 a, float_8 b)  { return float_8(_mm_cmpgt_ps(a.lo, b.lo), _mm_cmpgt_ps(a.hi, b.hi)); }
+inline float_8 operator==(float_8 a, float_8 b) { return float_8(_mm_cmpeq_ps(a.lo, b.lo), _mm_cmpeq_ps(a.hi, b.hi)); }
+
+inline float_8 fmin(float_8 a, float_8 b) { return float_8(_mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi)); }
+inline float_8 fmax(float_8 a, float_8 b) { return float_8(_mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi)); }
+// clang-format on
+
+inline float_8 fabs(float_8 a) {
+    __m128 sign = _mm_set1_ps(-0.0f);
+    return float_8(_mm_andnot_ps(sign, a.lo), _mm_andnot_ps(sign, a.hi));
+}
+
+// Lanes where mask is set take a, the others take b.
+inline float_8 ifelse(float_8 mask, float_8 a, float_8 b) {
+    return float_8(
+        _mm_or_ps(_mm_and_ps(mask.lo, a.lo), _mm_andnot_ps(mask.lo, b.lo)),
+        _mm_or_ps(_mm_and_ps(mask.hi, a.hi), _mm_andnot_ps(mask.hi, b.hi)));
+}
+
+// SSE2 has no rounding instruction, so truncate and step down where that
+// rounded negative values up. Exact for |a| < 2^31.
+inline float_8 floor(float_8 a) {
+    float_8 t(
+        _mm_cvtepi32_ps(_mm_cvttps_epi32(a.lo)), _mm_cvtepi32_ps(_mm_cvttps_epi32(a.hi)));
+    return ifelse(a < t, t - float_8(1.0f), t);
+}
+
+// Sums the lanes in a fixed order that every backend reproduces.
+inline float hsum(float_8 a) {
+    __m128 s = _mm_add_ps(a.lo, a.hi);
+    __m128 t = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    return _mm_cvtss_f32(_mm_add_ss(t, _mm_shuffle_ps(t, t, 1)));
+}
+
+// x * 2^n, for integral n in [-126, 127].
+inline float_8 ldexp(float_8 x, float_8 n) {
+    __m128i bias = _mm_set1_epi32(127);
+    __m128i elo = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n.lo), bias), 23);
+    __m128i ehi = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n.hi), bias), 23);
+    return float_8(
+        _mm_mul_ps(x.lo, _mm_castsi128_ps(elo)), _mm_mul_ps(x.hi, _mm_castsi128_ps(ehi)));
+}
+
+// Splits positive normal x into a mantissa in [0.5, 1) and an exponent.
+inline float_8 frexp(float_8 x, float_8* e) {
+    __m128i bias = _mm_set1_epi32(126);
+    __m128i mask = _mm_set1_epi32(0x007fffff);
+    __m128i half = _mm_set1_epi32(0x3f000000);
+
+    __m128i ilo = _mm_castps_si128(x.lo);
+    __m128i ihi = _mm_castps_si128(x.hi);
+
+    *e = float_8(
+        _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(ilo, 23), bias)),
+        _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(ihi, 23), bias)));
+
+    return float_8(
+        _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(ilo, mask), half)),
+        _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(ihi, mask), half)));
+}
+
+#else
+
+//--------------------------------------------------------------
+// float_8: portable
+//--------------------------------------------------------------
+
+struct float_8 {
+
+    float s[8];
+
+    float_8() {
+    }
+
+    float_8(float x) {
+        for (int i = 0; i < 8; i++) {
+            s[i] = x;
+        }
+    }
+
+    static float_8 load(const float* p) {
+        float_8 r;
+        for (int i = 0; i < 8; i++) {
+            r.s[i] = p[i];
+        }
+        return r;
+    }
+
+    void store(float* p) const {
+        for (int i = 0; i < 8; i++) {
+            p[i] = s[i];
+        }
+    }
+
+    // Lane i holds i.
+    static float_8 lanes() {
+        float_8 r;
+        for (int i = 0; i < 8; i++) {
+            r.s[i] = (float)i;
+        }
+        return r;
+    }
+};
+
+// Masks are stored as 0.0f / 1.0f rather than bit patterns.
+#define ARC_SIMD_LANEWISE(name, expr)                                                              \
+    inline float_8 name(float_8 a, float_8 b) {                                                    \
+        float_8 r;                                                                                 \
+        for (int i = 0; i < 8; i++) {                                                              \
+            float x = a.s[i], y = b.s[i];                                                          \
+            r.s[i] = (expr);                                                                       \
+        }                                                                                          \
+        return r;                                                                                  \
+    }
+
+ARC_SIMD_LANEWISE(operator+, x + y)
+ARC_SIMD_LANEWISE(operator-, x - y)
+ARC_SIMD_LANEWISE(operator*, x * y)
+ARC_SIMD_LANEWISE(operator/, x / y)
+ARC_SIMD_LANEWISE(operator<, x < y ? 1.0f : 0.0f)
+ARC_SIMD_LANEWISE(operator>, x > y ? 1.0f : 0.0f)
+ARC_SIMD_LANEWISE(operator==, x == y ? 1.0f : 0.0f)
+// Same NaN handling as minps/maxps: if either is NaN, the result is y.
+ARC_SIMD_LANEWISE(fmin, x < y ? x : y)
+ARC_SIMD_LANEWISE(fmax, x > y ? x : y)
+
+#undef ARC_SIMD_LANEWISE
+
+inline float_8 fabs(float_8 a) {
+    for (int i = 0; i < 8; i++) {
+        a.s[i] = fabsf(a.s[i]);
+    }
+    return a;
+}
+
+inline float_8 floor(float_8 a) {
+    for (int i = 0; i < 8; i++) {
+        a.s[i] = floorf(a.s[i]);
+    }
+    return a;
+}
+
+inline float_8 ifelse(float_8 mask, float_8 a, float_8 b) {
+    for (int i = 0; i < 8; i++) {
+        a.s[i] = (mask.s[i] != 0.0f) ? a.s[i] : b.s[i];
+    }
+    return a;
+}
+
+// Sums the lanes in a fixed order that every backend reproduces.
+inline float hsum(float_8 a) {
+    float s[4];
+    for (int i = 0; i < 4; i++) {
+        s[i] = a.s[i] + a.s[i + 4];
+    }
+    return (s[0] + s[2]) + (s[1] + s[3]);
+}
+
+inline float_8 ldexp(float_8 x, float_8 n) {
+    for (int i = 0; i < 8; i++) {
+        x.s[i] = ldexpf(x.s[i], (int)n.s[i]);
+    }
+    return x;
+}
+
+inline float_8 frexp(float_8 x, float_8* e) {
+    for (int i = 0; i < 8; i++) {
+        int ei;
+        x.s[i] = frexpf(x.s[i], &ei);
+        e->s[i] = (float)ei;
+    }
+    return x;
+}
+
+#endif
+
+//--------------------------------------------------------------
+// float_8: shared
+//--------------------------------------------------------------
+
+inline float_8& operator+=(float_8& a, float_8 b) {
+    return a = a + b;
+}
+
+inline float_8& operator*=(float_8& a, float_8 b) {
+    return a = a * b;
+}
+
+// Loads the first n lanes, and zeroes the rest, without reading past p[n - 1].
+inline float_8 loadPartial(const float* p, int n) {
+    if (n >= 8) {
+        return float_8::load(p);
+    }
+    float lanes[8] = {};
+    for (int i = 0; i < n; i++) {
+        lanes[i] = p[i];
+    }
+    return float_8::load(lanes);
+}
+
+// Stores the first n lanes, without writing past p[n - 1].
+inline void storePartial(float_8 v, float* p, int n) {
+    if (n >= 8) {
+        v.store(p);
+        return;
+    }
+    float lanes[8];
+    v.store(lanes);
+    for (int i = 0; i < n; i++) {
+        p[i] = lanes[i];
+    }
+}
+
+inline float_8 clamp(float_8 x, float_8 lo, float_8 hi) {
+    return fmin(fmax(x, lo), hi);
+}
+
+// 2^x, after Cephes exp2f. Within a couple of ulp of exp2f() for x in
+// [-126, 126].
+inline float_8 exp2(float_8 x) {
+    x = clamp(x, -126.0f, 126.0f);
+
+    float_8 n = floor(x + 0.5f);
+    float_8 f = x - n;
+
+    float_8 p = 1.535336188319500e-4f;
+    p = p * f + 1.339887440266574e-3f;
+    p = p * f + 9.618437357674640e-3f;
+    p = p * f + 5.550332471162809e-2f;
+    p = p * f + 2.402264791363012e-1f;
+    p = p * f + 6.931472028550421e-1f;
+    p = p * f + 1.0f;
+
+    return ldexp(p, n);
+}
+
+// log2(x) for positive normal x, after Cephes log2f.
+inline float_8 log2(float_8 x) {
+    float_8 e;
+    x = frexp(x, &e);
+
+    // Move the mantissa into [sqrt(0.5), sqrt(2))
+    float_8 small = x < 0.70710678f;
+    e = ifelse(small, e - 1.0f, e);
+    x = ifelse(small, x + x, x) - 1.0f;
+
+    float_8 z = x * x;
+
+    float_8 p = 7.0376836292e-2f;
+    p = p * x - 1.1514610310e-1f;
+    p = p * x + 1.1676998740e-1f;
+    p = p * x - 1.2420140846e-1f;
+    p = p * x + 1.4249322787e-1f;
+    p = p * x - 1.6668057665e-1f;
+    p = p * x + 2.0000714765e-1f;
+    p = p * x - 2.4999993993e-1f;
+    p = p * x + 3.3333331174e-1f;
+
+    float_8 y = x * z * p - z * 0.5f;
+
+    const float kLog2eMinus1 = 0.44269504088896340736f;
+    float_8 r = y * kLog2eMinus1;
+    r += x * kLog2eMinus1;
+    r += y;
+    r += x;
+    r += e;
+    return r;
+}
+
+#if defined(ARC_SIMD_AVX2)
+
+//--------------------------------------------------------------
+// double_4: AVX2
+//--------------------------------------------------------------
+
+// Only what the lowpass cascade kernel needs.
+struct double_4 {
+
+    __m256d v;
+
+    double_4() {
+    }
+
+    double_4(__m256d v_) : v(v_) {
+    }
+
+    double_4(double x) : v(_mm256_set1_pd(x)) {
+    }
+
+    static double_4 load(const double* p) {
+        return _mm256_loadu_pd(p);
+    }
+
+    void store(double* p) const {
+        _mm256_storeu_pd(p, v);
+    }
+};
+
+// clang-format off
+inline double_4 operator+(double_4 a, double_4 b) { return _mm256_add_pd(a.v, b.v); }
+inline double_4 operator-(double_4 a, double_4 b) { return _mm256_sub_pd(a.v, b.v); }
+inline double_4 operator*(double_4 a, double_4 b) { return _mm256_mul_pd(a.v, b.v); }
+
+inline double_4 operator<(double_4 a, double_4 b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ); }
+inline double_4 operator>(double_4 a, double_4 b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ); }
+// clang-format on
+
+// Lanes where mask is set take a, the others take b.
+inline double_4 ifelse(double_4 mask, double_4 a, double_4 b) {
+    return _mm256_blendv_pd(b.v, a.v, mask.v);
+}
+
+// Rounds each lane to the nearest float.
+inline double_4 roundToFloat(double_4 a) {
+    return _mm256_cvtps_pd(_mm256_cvtpd_ps(a.v));
+}
+
+// Shifts b up a lane, and fills lane 0 from the top lane of a:
+// {a[3], b[0], b[1], b[2]}.
+inline double_4 slide(double_4 a, double_4 b) {
+    __m256d middle = _mm256_permute2f128_pd(a.v, b.v, 0x21);
+    return _mm256_shuffle_pd(middle, b.v, 0x5);
+}
+
+#elif defined(ARC_SIMD_SSE2)
+
+//--------------------------------------------------------------
+// double_4: SSE2
+//--------------------------------------------------------------
+
+struct double_4 {
+
+    __m128d lo;
+    __m128d hi;
+
+    double_4() {
+    }
+
+    double_4(__m128d lo_, __m128d hi_) : lo(lo_), hi(hi_) {
+    }
+
+    double_4(double x) : lo(_mm_set1_pd(x)), hi(_mm_set1_pd(x)) {
+    }
+
+    static double_4 load(const double* p) {
+        return double_4(_mm_loadu_pd(p), _mm_loadu_pd(p + 2));
+    }
+
+    void store(double* p) const {
+        _mm_storeu_pd(p, lo);
+        _mm_storeu_pd(p + 2, hi);
+    }
+};
+
+// clang-format off
+inline double_4 operator+(double_4 a, double_4 b) { return double_4(_mm_add_pd(a.lo, b.lo), _mm_add_pd(a.hi, b.hi)); }
+inline double_4 operator-(double_4 a, double_4 b) { return double_4(_mm_sub_pd(a.lo, b.lo), _mm_sub_pd(a.hi, b.hi)); }
+inline double_4 operator*(double_4 a, double_4 b) { return double_4(_mm_mul_pd(a.lo, b.lo), _mm_mul_pd(a.hi, b.hi)); }
+
+inline double_4 operator<(double_4 a, double_4 b) { return double_4(_mm_cmplt_pd(a.lo, b.lo), _mm_cmplt_pd(a.hi, b.hi)); }
+inline double_4 operator>(double_4 a, double_4 b) { return double_4(_mm_cmpgt_pd(a.lo, b.lo), _mm_cmpgt_pd(a.hi, b.hi)); }
+// clang-format on
+
+inline double_4 ifelse(double_4 mask, double_4 a, double_4 b) {
+    return double_4(
+        _mm_or_pd(_mm_and_pd(mask.lo, a.lo), _mm_andnot_pd(mask.lo, b.lo)),
+        _mm_or_pd(_mm_and_pd(mask.hi, a.hi), _mm_andnot_pd(mask.hi, b.hi)));
+}
+
+inline double_4 roundToFloat(double_4 a) {
+    return double_4(_mm_cvtps_pd(_mm_cvtpd_ps(a.lo)), _mm_cvtps_pd(_mm_cvtpd_ps(a.hi)));
+}
+
+inline double_4 slide(double_4 a, double_4 b) {
+    return double_4(_mm_shuffle_pd(a.hi, b.lo, 1), _mm_shuffle_pd(b.lo, b.hi, 1));
+}
+
+#else
+
+//--------------------------------------------------------------
+// double_4: portable
+//--------------------------------------------------------------
+
+struct double_4 {
+
+    double s[4];
+
+    double_4() {
+    }
+
+    double_4(double x) {
+        for (int i = 0; i < 4; i++) {
+            s[i] = x;
+        }
+    }
+
+    static double_4 load(const double* p) {
+        double_4 r;
+        for (int i = 0; i < 4; i++) {
+            r.s[i] = p[i];
+        }
+        return r;
+    }
+
+    void store(double* p) const {
+        for (int i = 0; i < 4; i++) {
+            p[i] = s[i];
+        }
+    }
+};
+
+// Masks are stored as 0.0 / 1.0 rather than bit patterns.
+#define ARC_SIMD_LANEWISE(name, expr)                                                              \
+    inline double_4 name(double_4 a, double_4 b) {                                                 \
+        double_4 r;                                                                                \
+        for (int i = 0; i < 4; i++) {                                                              \
+            double x = a.s[i], y = b.s[i];                                                         \
+            r.s[i] = (expr);                                                                       \
+        }                                                                                          \
+        return r;                                                                                  \
+    }
+
+ARC_SIMD_LANEWISE(operator+, x + y)
+ARC_SIMD_LANEWISE(operator-, x - y)
+ARC_SIMD_LANEWISE(operator*, x * y)
+ARC_SIMD_LANEWISE(operator<, x < y ? 1.0 : 0.0)
+ARC_SIMD_LANEWISE(operator>, x > y ? 1.0 : 0.0)
+
+#undef ARC_SIMD_LANEWISE
+
+inline double_4 ifelse(double_4 mask, double_4 a, double_4 b) {
+    for (int i = 0; i < 4; i++) {
+        a.s[i] = (mask.s[i] != 0.0) ? a.s[i] : b.s[i];
+    }
+    return a;
+}
+
+inline double_4 roundToFloat(double_4 a) {
+    for (int i = 0; i < 4; i++) {
+        a.s[i] = (float)a.s[i];
+    }
+    return a;
+}
+
+inline double_4 slide(double_4 a, double_4 b) {
+    double_4 r;
+    r.s[0] = a.s[3];
+    for (int i = 1; i < 4; i++) {
+        r.s[i] = b.s[i - 1];
+    }
+    return r;
+}
+
+#endif
+
+} // namespace ARC_SIMD_BACKEND
+} // namespace simd
+} // namespace arc
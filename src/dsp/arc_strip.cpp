@@ -0,0 +1,79 @@
+#include "arc_strip.hpp"
+
+namespace arc {
+namespace dsp {
+
+void StripEngine::onSampleRateChange(float sampleRate) {
+    levelAmp.onSampleRateChange(sampleRate);
+    for (int ch = 0; ch < kKernelWidth; ch++) {
+        levelCvAmps[ch].onSampleRateChange(sampleRate);
+        panners[ch].onSampleRateChange(sampleRate);
+    }
+}
+
+void StripEngine::processBlock(
+    const float* inLeft,
+    const float* inRight,
+    float* outLeft,
+    float* outRight,
+    int frames,
+    int channels) {
+
+    const Kernels& k = kernels();
+    float leftAmps[kKernelWidth];
+    float rightAmps[kKernelWidth];
+
+    if (saturate && !saturating) {
+        for (int ch = 0; ch < kKernelWidth; ch++) {
+            leftPrevious[ch] = 0.0f;
+            rightPrevious[ch] = 0.0f;
+        }
+    }
+    saturating = saturate;
+
+    for (int f = 0; f < frames; f++) {
+        int base = f * channels;
+
+        float amp = levelAmp.next(muted ? kMinDb : level, coarse);
+        for (int ch = 0; ch < channels; ch++) {
+            float chAmp = amp;
+
+            // level cv
+            if (levelCv) {
+                float db = muted ? kMinDb : levelCvToDb(levelCv[base + ch]);
+                chAmp *= levelCvAmps[ch].next(db, coarse);
+            }
+
+            // panning
+            float chPan = pan;
+            if (panCv) {
+                chPan += panCv[base + ch] * 0.2f;
+            }
+            chPan = (chPan < -1.0f) ? -1.0f : ((chPan > 1.0f) ? 1.0f : chPan);
+            panners[ch].next(chPan, coarse);
+
+            leftAmps[ch] = chAmp * panners[ch].left;
+            rightAmps[ch] = chAmp * panners[ch].right;
+        }
+
+        if (saturating) {
+            leftSum = k.saturatingGain(
+                inLeft + base, 1, leftAmps, outLeft + base, leftPrevious, channels);
+            rightSum = k.saturatingGain(
+                inRight + base, 1, rightAmps, outRight + base, rightPrevious, channels);
+        } else {
+            leftSum = k.gain(inLeft + base, 1, leftAmps, outLeft + base, channels);
+            rightSum = k.gain(inRight + base, 1, rightAmps, outRight + base, channels);
+        }
+
+        if (leftSums) {
+            leftSums[f] = leftSum;
+        }
+        if (rightSums) {
+            rightSums[f] = rightSum;
+        }
+    }
+}
+
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,88 @@
+#pragma once
+
+// The TRACK-4 strip engine: a stereo level and pan with optional per-channel
+// level and pan CVs, hard clipped or saturated at +/-10V. This header does not
+// depend on Rack.
+
+#include <cstddef>
+
+#include "arc_kernels.hpp"
+#include "arc_ramp.hpp"
+
+namespace arc {
+namespace dsp {
+
+// Widens one side of a stereo input to maxChans channels, so both sides can
+// go through the strip together. A monophonic side is applied to every
+// channel, the same way Port::getPolyVoltage() would; a polyphonic side
+// keeps its own voices, and the channels it doesn't have are 0V. Returns in
+// itself if it already has maxChans channels, or else buffer.
+inline const float* spreadChannels(const float* in, int channels, int maxChans, float* buffer) {
+    if (channels == maxChans) {
+        return in;
+    }
+    for (int ch = 0; ch < maxChans; ch++) {
+        if (channels == 1) {
+            buffer[ch] = in[0];
+        } else {
+            buffer[ch] = (ch < channels) ? in[ch] : 0.0f;
+        }
+    }
+    return buffer;
+}
+
+class StripEngine {
+
+    Amplifier levelAmp;
+    Amplifier levelCvAmps[kKernelWidth];
+    Panner panners[kKernelWidth];
+
+    // The saturator's last input on each channel, cleared whenever it's
+    // switched on.
+    float leftPrevious[kKernelWidth] = {};
+    float rightPrevious[kKernelWidth] = {};
+    bool saturating = false;
+
+  public:
+
+    // Read by each processBlock().
+    float level = 0.0f; // in dB
+    float pan = 0.0f;   // -1 to 1
+    bool muted = false;
+
+    // Per channel, laid out like the audio, or NULL if unpatched. The level
+    // CV is 0V to 10V, and the pan CV -5V to 5V.
+    const float* levelCv = NULL;
+    const float* panCv = NULL;
+
+    // Use the coarse level and pan laws of the lowest quality tier.
+    bool coarse = false;
+
+    // Saturate each channel with an anti-aliased soft clip instead of hard
+    // clipping it.
+    bool saturate = false;
+
+    // If not NULL, each receives the sum of every channel, once per frame.
+    float* leftSums = NULL;
+    float* rightSums = NULL;
+
+    // The sums of the last frame.
+    float leftSum = 0.0f;
+    float rightSum = 0.0f;
+
+    void onSampleRateChange(float sampleRate);
+
+    // Each buffer holds `frames` frames of `channels` interleaved samples.
+    // To play a mono source into a wider strip, repeat it across the
+    // channels.
+    void processBlock(
+        const float* inLeft,
+        const float* inRight,
+        float* outLeft,
+        float* outRight,
+        int frames,
+        int channels);
+};
+
+} // namespace dsp
+} // namespace arc
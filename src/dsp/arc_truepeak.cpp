@@ -0,0 +1,31 @@
+#include "arc_truepeak.hpp"
+
+namespace arc {
+namespace dsp {
+
+void TruePeak::reset() {
+    for (float& h : history) {
+        h = 0.0f;
+    }
+    pos = 0;
+    left = 0.0f;
+    right = 0.0f;
+}
+
+void TruePeak::process(float left_, float right_) {
+    float* a = history + pos * kFrameWidth;
+    float* b = a + kTruePeakTaps * kFrameWidth;
+    for (int i = 0; i < 4; i++) {
+        a[i] = b[i] = left_;
+        a[4 + i] = b[4 + i] = right_;
+    }
+    pos = (pos + 1) % kTruePeakTaps;
+
+    float peaks[2];
+    kernels().truePeak(history + pos * kFrameWidth, peaks);
+    left = peaks[0];
+    right = peaks[1];
+}
+
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,40 @@
+#pragma once
+
+// A stereo true-peak estimator, in the style of ITU-R BS.1770: it
+// interpolates 4x to find the overs that fall between samples, but keeps only
+// the peak of each side, never the oversampled signal. Both sides run in one
+// vector through kernels().truePeak. The estimate trails the input by about
+// six samples, the filter's delay. This header does not depend on Rack.
+
+#include "arc_kernels.hpp"
+
+namespace arc {
+namespace dsp {
+
+class TruePeak {
+
+    static const int kFrameWidth = 8;
+
+    // Each frame is written twice, kTruePeakTaps frames apart, so the latest
+    // kTruePeakTaps frames always sit in one run starting at pos.
+    float history[2 * kTruePeakTaps * kFrameWidth];
+    int pos = 0;
+
+  public:
+
+    // The latest estimate for each side: the largest magnitude of the four
+    // interpolated samples.
+    float left = 0.0f;
+    float right = 0.0f;
+
+    TruePeak() {
+        reset();
+    }
+
+    void reset();
+
+    void process(float left_, float right_);
+};
+
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,55 @@
+#include "arc_wav.hpp"
+
+namespace arc {
+namespace dsp {
+
+static void putU16(unsigned char*& p, uint32_t v) {
+    *p++ = v & 0xFF;
+    *p++ = (v >> 8) & 0xFF;
+}
+
+static void putU32(unsigned char*& p, uint32_t v) {
+    putU16(p, v & 0xFFFF);
+    putU16(p, v >> 16);
+}
+
+static void putTag(unsigned char*& p, const char* tag) {
+    for (int i = 0; i < 4; i++) {
+        *p++ = tag[i];
+    }
+}
+
+void writeWavHeader(std::FILE* file, int sampleRate, int channels, uint32_t frames) {
+    const uint32_t kBytesPerFrame = channels * sizeof(float);
+    uint32_t dataSize = frames * kBytesPerFrame;
+
+    unsigned char header[kWavHeaderSize];
+    unsigned char* p = header;
+
+    putTag(p, "RIFF");
+    putU32(p, kWavHeaderSize - 8 + dataSize);
+    putTag(p, "WAVE");
+
+    putTag(p, "fmt ");
+    putU32(p, 18);
+    putU16(p, 3); // WAVE_FORMAT_IEEE_FLOAT
+    putU16(p, channels);
+    putU32(p, sampleRate);
+    putU32(p, sampleRate * kBytesPerFrame);
+    putU16(p, kBytesPerFrame);
+    putU16(p, 32);
+    putU16(p, 0);
+
+    putTag(p, "fact");
+    putU32(p, 4);
+    putU32(p, frames);
+
+    putTag(p, "data");
+    putU32(p, dataSize);
+
+    std::fseek(file, 0, SEEK_SET);
+    std::fwrite(header, 1, kWavHeaderSize, file);
+}
+
+} // namespace dsp
+} // namespace arc
@@ -0,0 +1,20 @@
+#pragma once
+
+// WAV file headers, shared by the capture and the offline renderer. This
+// header does not depend on Rack.
+
+#include <cstdint>
+#include <cstdio>
+
+namespace arc {
+namespace dsp {
+
+// The size of the header written by writeWavHeader().
+const int kWavHeaderSize = 58;
+
+// Writes a WAVE_FORMAT_IEEE_FLOAT header, with the fact chunk that non-PCM
+// formats need, at the start of the file. 32-bit float samples follow it.
+void writeWavHeader(std::FILE* file, int sampleRate, int channels, uint32_t frames);
+
+} // namespace dsp
+} // namespace arc
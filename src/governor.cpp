@@ -0,0 +1,38 @@
+#include "governor.hpp"
+
+arc::dsp::Governor& governor() {
+    static arc::dsp::Governor instance;
+    return instance;
+}
+
+//--------------------------------------------------------------
+// QualityBadge
+//--------------------------------------------------------------
+
+std::string QualityBadge::getText() {
+    int tier = governor().getTier();
+    if (!module || tier == arc::dsp::kTierFull) {
+        return "";
+    }
+    return string::f("ECO %d", tier);
+}
+
+QualityBadge* createQualityBadgeCentered(Vec pos, Module* module) {
+    QualityBadge* badge = new QualityBadge;
+    badge->module = module;
+    badge->box.pos = pos.minus(badge->box.size.div(2.0f));
+    return badge;
+}
+
+void appendQualityMenu(Menu* menu) {
+    int tier = governor().getTier();
+    if (tier == arc::dsp::kTierFull) {
+        menu->addChild(createMenuLabel(arc::dsp::tierName(tier)));
+        return;
+    }
+
+    menu->addChild(createMenuLabel(string::f("Eco %d: the engine is busy", tier)));
+    for (int t = 1; t <= tier; t++) {
+        menu->addChild(createMenuLabel(string::f("- %s", arc::dsp::tierName(t))));
+    }
+}
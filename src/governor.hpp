@@ -0,0 +1,57 @@
+#pragma once
+
+#include "arc_quality.hpp"
+#include "rack.hpp"
+#include "widgets.hpp"
+
+using namespace rack;
+
+// The plugin-wide governor. Modules read its tier once per sample, and
+// apply it to their own settings.
+arc::dsp::Governor& governor();
+
+//--------------------------------------------------------------
+// GovernorFeed
+//--------------------------------------------------------------
+
+// Feeds the governor Rack's engine meter every kDivision samples. Each of
+// the plugin's modules steps one from process(), so the governor runs
+// whenever any of them is in the patch, whether or not a panel is showing.
+struct GovernorFeed {
+
+    // About 10 ms at 48 kHz, which is plenty for holds of half a second.
+    static const int kDivision = 512;
+
+    dsp::ClockDivider divider;
+
+    GovernorFeed() {
+        divider.setDivision(kDivision);
+    }
+
+    void step() {
+        if (divider.process()) {
+            governor().update(system::getTime(), APP->engine->getMeterMax());
+        }
+    }
+};
+
+//--------------------------------------------------------------
+// QualityBadge
+//--------------------------------------------------------------
+
+// Shows the governor's tier on a module's panel while it is below full
+// quality.
+struct QualityBadge : ArcBadge {
+
+    Module* module = NULL;
+
+    QualityBadge() : ArcBadge(nvgRGB(0xFF, 0x87, 0x24), 26.0f) {
+    }
+
+    std::string getText() override;
+};
+
+QualityBadge* createQualityBadgeCentered(Vec pos, Module* module);
+
+// Adds the governor's tier to a module's context menu.
+void appendQualityMenu(Menu* menu);
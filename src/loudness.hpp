@@ -0,0 +1,72 @@
+#pragma once
+
+#include "arc_loudness.hpp"
+#include "rack.hpp"
+
+using namespace rack;
+
+//--------------------------------------------------------------
+// LoudnessDisplay
+//--------------------------------------------------------------
+
+// Shows the momentary, short-term and integrated loudness of a strip, one
+// reading per row.
+struct LoudnessDisplay : Widget {
+
+  private:
+
+    arc::dsp::Loudness* loudness = NULL;
+
+    NVGcolor color = nvgRGB(0x3E, 0xD5, 0x64);
+
+    void drawRow(const DrawArgs& args, int row, const char* label, float lufs) {
+        float rowHeight = box.size.y / 3.0f;
+        float y = rowHeight * (row + 0.5f);
+
+        std::string value =
+            (lufs > arc::dsp::Loudness::kSilence) ? string::f("%.1f", lufs) : std::string("--.-");
+
+        nvgFillColor(args.vg, nvgTransRGBA(color, 0xA0));
+        nvgFontSize(args.vg, 10.0f);
+        nvgTextAlign(args.vg, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
+        nvgText(args.vg, 6.0f, y, label, NULL);
+
+        nvgFillColor(args.vg, color);
+        nvgFontSize(args.vg, 22.0f);
+        nvgTextAlign(args.vg, NVG_ALIGN_RIGHT | NVG_ALIGN_MIDDLE);
+        nvgText(args.vg, box.size.x - 36.0f, y, value.c_str(), NULL);
+
+        nvgFillColor(args.vg, nvgTransRGBA(color, 0xA0));
+        nvgFontSize(args.vg, 10.0f);
+        nvgTextAlign(args.vg, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
+        nvgText(args.vg, box.size.x - 32.0f, y, "LUFS", NULL);
+    }
+
+  public:
+
+    void setLoudness(arc::dsp::Loudness* loudness_) {
+        loudness = loudness_;
+    }
+
+    void draw(const DrawArgs& args) override {
+        nvgBeginPath(args.vg);
+        nvgRect(args.vg, 0.0f, 0.0f, box.size.x, box.size.y);
+        nvgFillColor(args.vg, nvgRGBA(0x00, 0x00, 0x00, 0xC0));
+        nvgFill(args.vg);
+
+        if (!loudness) {
+            return;
+        }
+
+        std::shared_ptr<window::Font> font =
+            APP->window->loadFont(asset::system("res/fonts/ShareTechMono-Regular.ttf"));
+        if (!font) {
+            return;
+        }
+        nvgFontFaceId(args.vg, font->handle);
+
+        drawRow(args, 0, "M", loudness->getMomentary());
+        drawRow(args, 1, "S", loudness->getShortTerm());
+        drawRow(args, 2, "I", loudness->getIntegrated());
+    }
+};
@@ -1,3 +1,5 @@
+#include "arc_kernels.hpp"
+#include "arc_ramp.hpp"
 #include "plugin.hpp"
 
 Plugin* pluginInstance;
@@ -5,6 +7,14 @@ Plugin* pluginInstance;
 void init(Plugin* p) {
     pluginInstance = p;
 
+    // Pick the widest kernels this CPU supports, before any module runs.
+    arc::dsp::selectKernels();
+    INFO("Using %s kernels", arc::dsp::kernels().name);
+
+    // Build the governor's lookup tables now, rather than on the audio thread
+    // the first time it needs them.
+    arc::dsp::gainTables();
+
     p->addModel(modelATV);
     p->addModel(modelCLIP);
     p->addModel(modelFM);
@@ -10,3 +10,38 @@ extern Model* modelCLIP;
 extern Model* modelFM;
 extern Model* modelGAIN;
 extern Model* modelTRACK4;
+
+//--------------------------------------------------------------
+// PolyCv
+//--------------------------------------------------------------
+
+// Gathers a CV input for the first `channels` channels into a buffer for
+// the arc::dsp engines, the way Port::getPolyVoltage() would. gather()
+// returns NULL if the input is unpatched, which the engines read as no CV at
+// all.
+//
+// With a division above 1, the input is only read on every division'th
+// call, and held in between: control rate CV, for the lower quality tiers.
+class PolyCv {
+
+    float values[engine::PORT_MAX_CHANNELS];
+    int channels = 0;
+    int count = 0;
+
+  public:
+
+    const float* gather(Input& input, int channels_, int division = 1) {
+        if (!input.isConnected()) {
+            channels = 0;
+            return NULL;
+        }
+        if (++count >= division || channels_ != channels) {
+            count = 0;
+            channels = channels_;
+            for (int ch = 0; ch < channels; ch++) {
+                values[ch] = input.getPolyVoltage(ch);
+            }
+        }
+        return values;
+    }
+};
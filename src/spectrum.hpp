@@ -0,0 +1,332 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "arc_dsp.hpp"
+#include "rack.hpp"
+
+using namespace rack;
+
+//--------------------------------------------------------------
+// AudioTap
+//--------------------------------------------------------------
+
+// A single-producer, single-consumer ring that the audio thread pushes
+// samples into, and the UI thread reads the most recent window from. The
+// writer never waits and never checks for room; it simply overwrites the
+// oldest samples. The ring is allocated the first time the tap is enabled,
+// so a tap that's never used costs almost nothing, and it's kept from then on,
+// so the audio thread never sees it freed.
+//
+// Even while enabled, the tap only listens on a lease that the analyzer
+// renews each time it's drawn. Rack doesn't draw a widget that's hidden or
+// scrolled off screen, or one that has no window at all, so within
+// kLeaseSeconds of that the audio thread stops pushing.
+
+class AudioTap {
+
+  public:
+
+    // Must be a power of 2, and comfortably more than a UI frame's worth of
+    // samples at any sample rate.
+    static const int kSize = 8192;
+
+    // Long enough to ride out a few slow UI frames.
+    static constexpr float kLeaseSeconds = 0.25f;
+
+  private:
+
+    static const uint32_t kMask = kSize - 1;
+
+    std::unique_ptr<std::atomic<float>[]> buffer;
+    std::atomic<uint32_t> written{0};
+
+    std::atomic<bool> enabled{false};
+    std::atomic<float> sampleRate{44100.0f};
+
+    // Samples left on the lease. The audio thread counts it down with a
+    // plain load and store, so a renewal that lands in between is lost, but
+    // the next frame renews it again.
+    std::atomic<int> lease{0};
+
+    // UI thread: where the samples pushed since the last renewal that found
+    // the lease run out start.
+    uint32_t fresh = 0;
+
+    // Audio thread: store the sample, then publish it. Both are plain moves
+    // on x86 and ARM; the writer owns `written`, so it needs no atomic
+    // read-modify-write.
+    void push(float v) {
+        uint32_t w = written.load(std::memory_order_relaxed);
+        buffer[w & kMask].store(v, std::memory_order_relaxed);
+        written.store(w + 1, std::memory_order_release);
+    }
+
+  public:
+
+    void onSampleRateChange(float sampleRate_) {
+        sampleRate.store(sampleRate_, std::memory_order_relaxed);
+    }
+
+    float getSampleRate() const {
+        return sampleRate.load(std::memory_order_relaxed);
+    }
+
+    // Once this returns true, the ring is safe to push to.
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_acquire);
+    }
+
+    // Called from the UI thread. May allocate.
+    void setEnabled(bool enabled_) {
+        if (enabled_ && !buffer) {
+            buffer.reset(new std::atomic<float>[kSize]);
+            for (int i = 0; i < kSize; i++) {
+                buffer[i].store(0.0f, std::memory_order_relaxed);
+            }
+        }
+        enabled.store(enabled_, std::memory_order_release);
+    }
+
+    // Audio thread, once per sample. Does nothing unless the tap is enabled
+    // and its lease is current.
+    void process(float v) {
+        if (!isEnabled()) {
+            return;
+        }
+        int l = lease.load(std::memory_order_relaxed);
+        if (l > 0) {
+            lease.store(l - 1, std::memory_order_relaxed);
+            push(v);
+        }
+    }
+
+    // UI thread: keeps the audio thread pushing for another kLeaseSeconds.
+    void renew() {
+        if (lease.load(std::memory_order_relaxed) == 0) {
+            fresh = written.load(std::memory_order_acquire);
+        }
+        lease.store((int)(getSampleRate() * kLeaseSeconds), std::memory_order_relaxed);
+    }
+
+    // UI thread: copies the most recent n samples, oldest first. Returns
+    // false if the lease has run out, if fewer than n samples have been
+    // pushed since it was renewed, or if the writer lapped the copy. In
+    // each case the caller should skip this frame.
+    bool read(float* out, int n) {
+        if (!buffer || lease.load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+        uint32_t w = written.load(std::memory_order_acquire);
+        if (w - fresh < (uint32_t)n) {
+            return false;
+        }
+        for (int i = 0; i < n; i++) {
+            out[i] = buffer[(w - n + i) & kMask].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t lapped = written.load(std::memory_order_relaxed) - w;
+        return lapped < (uint32_t)(kSize - n);
+    }
+};
+
+//--------------------------------------------------------------
+// SpectrumAnalyzer
+//--------------------------------------------------------------
+
+// Draws the spectrum of a pair of taps on a log-frequency scale. All of the
+// analysis happens in step(), on the UI thread, once per frame while the
+// taps are listening; draw() renews their leases. The left and right power
+// spectra are averaged, so the two taps don't need to be sample aligned.
+
+struct SpectrumAnalyzer : Widget {
+
+  private:
+
+    static const int kFftSize = 2048;
+    static const int kBins = kFftSize / 2;
+    static const int kMaxColumns = 512;
+
+    static constexpr float kMinFreq = 20.0f;
+    static constexpr float kMaxFreq = 20000.0f;
+    static constexpr float kMinDb = -84.0f;
+    static constexpr float kMaxDb = 6.0f;
+
+    // How fast the curve falls back after a peak, in dB per frame.
+    static constexpr float kFallDb = 1.5f;
+
+    AudioTap* taps[2] = {NULL, NULL};
+
+    dsp::RealFFT fft;
+
+    float window[kFftSize];
+    alignas(16) float input[kFftSize];
+    alignas(16) float output[kFftSize * 2];
+    float power[kBins];
+    float columns[kMaxColumns];
+
+    NVGcolor color = nvgRGB(0x3E, 0xD5, 0x64);
+
+    // Adds the windowed power spectrum of the tap to power[]. Returns false
+    // if the tap couldn't be read cleanly.
+    bool analyze(AudioTap* tap, float scale) {
+        if (!tap->read(input, kFftSize)) {
+            return false;
+        }
+        for (int i = 0; i < kFftSize; i++) {
+            input[i] *= window[i];
+        }
+        fft.rfft(input, output);
+
+        for (int b = 1; b < kBins; b++) {
+            float re = output[2 * b];
+            float im = output[2 * b + 1];
+            power[b] += (re * re + im * im) * scale;
+        }
+        return true;
+    }
+
+    // The power at a fractional bin, interpolated between its neighbours.
+    float powerAt(float bin) {
+        int b = clamp((int)bin, 1, kBins - 2);
+        float t = clamp(bin - b, 0.0f, 1.0f);
+        return power[b] + (power[b + 1] - power[b]) * t;
+    }
+
+    void clearColumns() {
+        for (int c = 0; c < kMaxColumns; c++) {
+            columns[c] = kMinDb;
+        }
+    }
+
+    float dbToY(float db) {
+        return rescale(db, kMinDb, kMaxDb, box.size.y, 0.0f);
+    }
+
+    float freqToX(float freq) {
+        return box.size.x * std::log(freq / kMinFreq) / std::log(kMaxFreq / kMinFreq);
+    }
+
+    void drawGrid(const DrawArgs& args) {
+        nvgStrokeColor(args.vg, nvgRGBA(0xFF, 0xFF, 0xFF, 0x20));
+        nvgStrokeWidth(args.vg, 0.5f);
+
+        nvgBeginPath(args.vg);
+        const float freqs[] = {100.0f, 1000.0f, 10000.0f};
+        for (float f : freqs) {
+            float x = freqToX(f);
+            nvgMoveTo(args.vg, x, 0.0f);
+            nvgLineTo(args.vg, x, box.size.y);
+        }
+        for (float db = 0.0f; db > kMinDb; db -= 24.0f) {
+            float y = dbToY(db);
+            nvgMoveTo(args.vg, 0.0f, y);
+            nvgLineTo(args.vg, box.size.x, y);
+        }
+        nvgStroke(args.vg);
+    }
+
+  public:
+
+    SpectrumAnalyzer() : fft(kFftSize) {
+        for (int i = 0; i < kFftSize; i++) {
+            window[i] = dsp::hann((float)i / kFftSize);
+        }
+        clearColumns();
+    }
+
+    // Either tap may be NULL.
+    void setTaps(AudioTap* left, AudioTap* right) {
+        if (left != taps[0] || right != taps[1]) {
+            clearColumns();
+        }
+        taps[0] = left;
+        taps[1] = right;
+    }
+
+    void step() override {
+        Widget::step();
+        if (!isVisible()) {
+            return;
+        }
+
+        AudioTap* tap = taps[0] ? taps[0] : taps[1];
+        if (!tap) {
+            return;
+        }
+
+        // Scale the power so that a full scale (5V) sine reads 0 dB: the
+        // Hann window's coherent gain is 1/2, so a sine of amplitude A lands
+        // at |X| = A * N / 4.
+        int n = (taps[0] && taps[1]) ? 2 : 1;
+        float norm = 4.0f / (kFftSize * 5.0f);
+        float scale = norm * norm / n;
+
+        std::fill(power, power + kBins, 0.0f);
+        for (int t = 0; t < 2; t++) {
+            if (taps[t] && !analyze(taps[t], scale)) {
+                return;
+            }
+        }
+
+        // Log-frequency columns. Where a column spans several bins it shows
+        // the loudest; at the low end, where bins are wider than columns, it
+        // interpolates.
+        float binHz = tap->getSampleRate() / kFftSize;
+        int width = std::min((int)box.size.x, kMaxColumns);
+        float ratio = kMaxFreq / kMinFreq;
+
+        for (int c = 0; c < width; c++) {
+            float lo = kMinFreq * std::pow(ratio, (float)c / width) / binHz;
+            float hi = kMinFreq * std::pow(ratio, (float)(c + 1) / width) / binHz;
+
+            float p = powerAt((lo + hi) * 0.5f);
+            for (int b = (int)std::ceil(lo); b < hi && b < kBins; b++) {
+                p = std::max(p, power[b]);
+            }
+
+            float db = 10.0f * std::log10(std::max(p, 1e-12f));
+            columns[c] = std::max(db, columns[c] - kFallDb);
+        }
+    }
+
+    void draw(const DrawArgs& args) override {
+        for (AudioTap* tap : taps) {
+            if (tap) {
+                tap->renew();
+            }
+        }
+
+        nvgBeginPath(args.vg);
+        nvgRect(args.vg, 0.0f, 0.0f, box.size.x, box.size.y);
+        nvgFillColor(args.vg, nvgRGBA(0x00, 0x00, 0x00, 0xC0));
+        nvgFill(args.vg);
+
+        drawGrid(args);
+
+        int width = std::min((int)box.size.x, kMaxColumns);
+        if (width < 2) {
+            return;
+        }
+
+        nvgSave(args.vg);
+        nvgScissor(args.vg, 0.0f, 0.0f, box.size.x, box.size.y);
+
+        nvgBeginPath(args.vg);
+        nvgMoveTo(args.vg, 0.0f, box.size.y);
+        for (int c = 0; c < width; c++) {
+            nvgLineTo(args.vg, c + 0.5f, dbToY(columns[c]));
+        }
+        nvgLineTo(args.vg, width, box.size.y);
+        nvgFillColor(args.vg, nvgTransRGBA(color, 0x60));
+        nvgFill(args.vg);
+        nvgStrokeColor(args.vg, color);
+        nvgStrokeWidth(args.vg, 1.0f);
+        nvgStroke(args.vg);
+
+        nvgRestore(args.vg);
+    }
+};
@@ -2,13 +2,19 @@
 
 #include "rack.hpp"
 
+#include <memory>
+
+#include "arc_capture.hpp"
+#include "arc_loudness.hpp"
+#include "arc_strip.hpp"
+#include "arc_truepeak.hpp"
+#include "governor.hpp"
+#include "plugin.hpp"
+#include "spectrum.hpp"
 #include "vu.hpp"
 
 using namespace rack;
 
-static const float kMinDb = -60.0f;
-static const float kMaxDb = 12.0f;
-
 //--------------------------------------------------------------
 // LevelParamQuantity
 //--------------------------------------------------------------
@@ -55,26 +61,96 @@ struct LevelParamQuantity : ParamQuantity {
 
 struct MonoTrack {
 
-    Output output;
+    // Per-channel voltages are written straight into this port. The mix
+    // track has no per-channel output, so it leaves this NULL.
+    Output* output = NULL;
+    int channels = 0;
+
     float sum = 0.f;
     VuStats vuStats;
 
+    // Feeds the sum to a spectrum analyzer while this strip is picked under
+    // "Spectrum" and the analyzer is being drawn.
+    AudioTap tap;
+
     void onSampleRateChange(float sampleRate) {
         vuStats.onSampleRateChange(sampleRate);
+        tap.onSampleRateChange(sampleRate);
     }
 
-    void processChannel(Input* input, int ch, float amp) {
+    // Takes the sum of the `computed` channels the strip engine wrote to
+    // out. They all count towards the sum, but only the first `channels_`
+    // are sent.
+    void finish(float* out, float sum_, int computed, int channels_) {
+
+        sum = sum_;
 
-        // hard clip
-        float out = clamp(input->getPolyVoltage(ch) * amp, -10.0f, 10.0f);
+        for (int ch = channels_; ch < computed; ch++) {
+            out[ch] = 0.0f;
+        }
+        setChannels(channels_);
+        tap.process(sum);
+    }
 
-        output.voltages[ch] = out;
-        sum += out;
+    void setChannels(int channels_) {
+        channels = channels_;
+        if (output) {
+            output->setChannels(channels);
+        }
     }
 
-    void disconnect(float sampleTime) {
+    void disconnect() {
         sum = 0.f;
-        vuStats.process(sampleTime, 0.0f);
+        channels = 1;
+        if (output) {
+            output->setVoltage(0.f);
+            output->setChannels(1);
+        }
+        tap.process(0.0f);
+    }
+};
+
+//--------------------------------------------------------------
+// PackedSend
+//--------------------------------------------------------------
+
+// A packed send carries every strip of a TRACK-4 on a single 16-channel
+// cable. Each side of each track gets kVoicesPerStrip consecutive channels,
+// ordered Track 1 L, Track 1 R, Track 2 L, ... so a consumer can unpack any
+// strip with unpack(), or find a single channel with channel(). In summed
+// mode the first channel of a strip holds its mono sum and the rest are 0V;
+// in voices mode they hold the strip's first kVoicesPerStrip voices, or 0V
+// where the strip has fewer.
+
+struct PackedSend {
+
+    enum Mode { kOff, kSummed, kVoices, kModesLen };
+
+    static const int kTracks = 4;
+    static const int kSides = 2;
+    static const int kVoicesPerStrip = 2;
+    static const int kChannels = kTracks * kSides * kVoicesPerStrip;
+
+    static int channel(int track, int side, int voice) {
+        return (track * kSides + side) * kVoicesPerStrip + voice;
+    }
+
+    // Copies one strip's kVoicesPerStrip channels out of a packed send's
+    // voltages, the reverse of pack().
+    static void unpack(const float* packed, int track, int side, float* out) {
+        for (int v = 0; v < kVoicesPerStrip; v++) {
+            out[v] = packed[channel(track, side, v)];
+        }
+    }
+
+    static void pack(Mode mode, const MonoTrack& strip, float* out) {
+        for (int v = 0; v < kVoicesPerStrip; v++) {
+            if (mode == kSummed) {
+                out[v] = (v == 0) ? strip.sum : 0.0f;
+            } else {
+                out[v] = (v < strip.channels) ? strip.output->voltages[v] : 0.0f;
+            }
+        }
     }
 };
 
@@ -86,9 +162,7 @@ class StereoTrack {
 
   private:
 
-    arc::dsp::Amplifier levelAmp;
-    arc::dsp::Amplifier levelCvAmps[engine::PORT_MAX_CHANNELS];
-    arc::dsp::Panner panners[engine::PORT_MAX_CHANNELS];
+    arc::dsp::StripEngine strip;
 
     Input* leftInput = NULL;
     Input* rightInput = NULL;
@@ -99,82 +173,78 @@ class StereoTrack {
     Param* panParam = NULL;
     Input* panCvInput = NULL;
 
-    float nextLevelCvAmp(int ch) {
-        float v = levelCvInput->getPolyVoltage(ch);
-        float db = rescale(v, 0.0f, 10.0f, kMinDb, kMaxDb);
-        return levelCvAmps[ch].next(db);
-    }
+    PolyCv levelCv;
+    PolyCv panCv;
 
-    void nextPanner(int ch, float pan) {
-        if (panCvInput->isConnected()) {
-            pan += panCvInput->getPolyVoltage(ch) * 0.2f;
-        }
-        pan = clamp(pan, -1.0f, 1.0f);
-        panners[ch].next(pan);
-    }
+    // Only runs while the meters are in true-peak mode. The audio thread
+    // clears its history whenever the mode comes on.
+    arc::dsp::TruePeak truePeak;
+    bool truePeakMode = false;
+    bool truePeakRunning = false;
 
-    void processStereo(float sampleTime, Input* inLeft, Input* inRight, bool muted) {
+    void processStereo(
+        const float* inLeft,
+        int leftChannels,
+        const float* inRight,
+        int rightChannels,
+        bool muted) {
 
-        left.sum = 0.0f;
-        right.sum = 0.0f;
+        leftChannels = std::max(leftChannels, 1);
+        rightChannels = std::max(rightChannels, 1);
 
-        left.output.channels = std::max(inLeft->getChannels(), 1);
-        right.output.channels = std::max(inRight->getChannels(), 1);
+        int maxChans = std::max(leftChannels, rightChannels);
 
-        int maxChans = std::max(left.output.channels, right.output.channels);
+        float leftSpread[engine::PORT_MAX_CHANNELS];
+        float rightSpread[engine::PORT_MAX_CHANNELS];
+        inLeft = arc::dsp::spreadChannels(inLeft, leftChannels, maxChans, leftSpread);
+        inRight = arc::dsp::spreadChannels(inRight, rightChannels, maxChans, rightSpread);
 
-        if (muted) {
-            float amp = levelAmp.next(kMinDb);
-            float pan = panParam->getValue();
+        int tier = governor().getTier();
+        int cvDivision = arc::dsp::cvDivision(tier);
+        strip.levelCv = levelCv.gather(*levelCvInput, maxChans, cvDivision);
+        strip.panCv = panCv.gather(*panCvInput, maxChans, cvDivision);
+        strip.coarse = arc::dsp::coarseTables(tier);
 
-            for (int ch = 0; ch < maxChans; ch++) {
-                float leftAmp = amp;
-                float rightAmp = amp;
+        strip.level = levelToDb(levelParam->getValue());
+        strip.pan = panParam->getValue();
+        strip.muted = muted;
 
-                // level cv
-                if (levelCvInput->isConnected()) {
-                    float nla = levelCvAmps[ch].next(kMinDb);
-                    leftAmp *= nla;
-                    rightAmp *= nla;
-                }
+        // The mix has no per-channel outputs.
+        float leftScratch[engine::PORT_MAX_CHANNELS];
+        float rightScratch[engine::PORT_MAX_CHANNELS];
+        float* outLeft = left.output ? left.output->voltages : leftScratch;
+        float* outRight = right.output ? right.output->voltages : rightScratch;
 
-                // panning
-                nextPanner(ch, pan);
-                leftAmp *= panners[ch].left;
-                rightAmp *= panners[ch].right;
+        strip.processBlock(inLeft, inRight, outLeft, outRight, 1, maxChans);
 
-                // process left/right
-                left.processChannel(inLeft, ch, leftAmp);
-                right.processChannel(inRight, ch, rightAmp);
-            }
-        } else {
-            float amp = levelAmp.next(levelToDb(levelParam->getValue()));
-            float pan = panParam->getValue();
-
-            for (int ch = 0; ch < maxChans; ch++) {
-                float leftAmp = amp;
-                float rightAmp = amp;
-
-                // level cv
-                if (levelCvInput->isConnected()) {
-                    float nla = nextLevelCvAmp(ch);
-                    leftAmp *= nla;
-                    rightAmp *= nla;
-                }
-
-                // panning
-                nextPanner(ch, pan);
-                leftAmp *= panners[ch].left;
-                rightAmp *= panners[ch].right;
-
-                // process left/right
-                left.processChannel(inLeft, ch, leftAmp);
-                right.processChannel(inRight, ch, rightAmp);
-            }
+        left.finish(outLeft, strip.leftSum, maxChans, leftChannels);
+        right.finish(outRight, strip.rightSum, maxChans, rightChannels);
+    }
+
+    void processMeters(float sampleTime) {
+
+        float leftSample = left.sum * 0.2f;
+        float rightSample = right.sum * 0.2f;
+
+        if (loudness) {
+            loudness->process(leftSample, rightSample);
+        }
+
+        if (truePeakMode != truePeakRunning) {
+            truePeakRunning = truePeakMode;
+            truePeak.reset();
+        }
+        if (truePeakRunning) {
+            truePeak.process(leftSample, rightSample);
+            leftSample = truePeak.left;
+            rightSample = truePeak.right;
         }
 
-        left.vuStats.process(sampleTime, left.sum * 0.2f);
-        right.vuStats.process(sampleTime, right.sum * 0.2f);
+        int meterDivision = arc::dsp::meterDivision(governor().getTier());
+        left.vuStats.setDivision(meterDivision);
+        right.vuStats.setDivision(meterDivision);
+        left.vuStats.process(sampleTime, leftSample);
+        right.vuStats.process(sampleTime, rightSample);
     }
 
   public:
@@ -182,21 +252,52 @@ class StereoTrack {
     MonoTrack left;
     MonoTrack right;
 
+    // Records the left and right sums to a WAV file while it is started.
+    arc::dsp::Capture capture;
+
+    // Measures the loudness of the sums, on strips that enableLoudness().
+    std::unique_ptr<arc::dsp::Loudness> loudness;
+
+    void enableLoudness() {
+        loudness.reset(new arc::dsp::Loudness);
+    }
+
+    // Meters the inter-sample peaks of the sums, rather than their samples.
+    void setTruePeakMode(bool truePeakMode_) {
+        truePeakMode = truePeakMode_;
+    }
+
+    bool getTruePeakMode() const {
+        return truePeakMode;
+    }
+
+    // Soft clips each channel at +/-10V, anti-aliased, rather than hard
+    // clipping it.
+    void setSaturation(bool saturate) {
+        strip.saturate = saturate;
+    }
+
+    bool getSaturation() const {
+        return strip.saturate;
+    }
+
     void onSampleRateChange(float sampleRate) {
 
-        levelAmp.onSampleRateChange(sampleRate);
-        for (int ch = 0; ch < engine::PORT_MAX_CHANNELS; ch++) {
-            levelCvAmps[ch].onSampleRateChange(sampleRate);
-            panners[ch].onSampleRateChange(sampleRate);
-        }
+        strip.onSampleRateChange(sampleRate);
 
         left.onSampleRateChange(sampleRate);
         right.onSampleRateChange(sampleRate);
+
+        if (loudness) {
+            loudness->onSampleRateChange(sampleRate);
+        }
     }
 
     void init(
         Input* leftInput_,
         Input* rightInput_,
+        Output* leftOutput,
+        Output* rightOutput,
         Param* levelParam_,
         Input* levelCvInput_,
         Param* panParam_,
@@ -204,33 +305,66 @@ class StereoTrack {
 
         leftInput = leftInput_;
         rightInput = rightInput_;
+        left.output = leftOutput;
+        right.output = rightOutput;
         levelParam = levelParam_;
         levelCvInput = levelCvInput_;
         panParam = panParam_;
         panCvInput = panCvInput_;
     }
 
+    // Process the track from its input ports.
     void process(float sampleTime, bool muted) {
 
         if (leftInput->isConnected()) {
             // stereo
             if (rightInput->isConnected()) {
-                processStereo(sampleTime, leftInput, rightInput, muted);
+                processStereo(
+                    leftInput->voltages,
+                    leftInput->getChannels(),
+                    rightInput->voltages,
+                    rightInput->getChannels(),
+                    muted);
             }
             // mono: copy left to right
             else {
-                processStereo(sampleTime, leftInput, leftInput, muted);
+                processStereo(
+                    leftInput->voltages,
+                    leftInput->getChannels(),
+                    leftInput->voltages,
+                    leftInput->getChannels(),
+                    muted);
             }
         } else {
             // mono: copy right to left
             if (rightInput->isConnected()) {
-                processStereo(sampleTime, rightInput, rightInput, muted);
+                processStereo(
+                    rightInput->voltages,
+                    rightInput->getChannels(),
+                    rightInput->voltages,
+                    rightInput->getChannels(),
+                    muted);
             }
             // no inputs
             else {
-                left.disconnect(sampleTime);
-                right.disconnect(sampleTime);
+                left.disconnect();
+                right.disconnect();
             }
         }
+
+        processMeters(sampleTime);
+
+        // Only the sums: capturing each polyphonic channel would take a
+        // ring, a file and a writer per channel.
+        capture.process(left.sum, right.sum);
+    }
+
+    // Process the track from contiguous left/right buffers that always carry
+    // the given number of channels.
+    void process(
+        float sampleTime, const float* inLeft, const float* inRight, int channels, bool muted) {
+        processStereo(inLeft, channels, inRight, channels, muted);
+        processMeters(sampleTime);
+        capture.process(left.sum, right.sum);
     }
 };
@@ -16,18 +16,51 @@ class VuStats {
     dsp::VuMeter2 peakMeter;
     dsp::ClockDivider maxPeakTimer;
 
+    float sampleRate = 44100.0f;
+
+    // Only every division'th sample updates the meter, with the loudest
+    // sample since the last update.
+    int division = 1;
+    int count = 0;
+    float held = 0.0f;
+
   public:
 
     float peak = 0.0f;
     float maxPeak = 0.0f;
 
-    void onSampleRateChange(float sampleRate) {
+    void onSampleRateChange(float sampleRate_) {
+        sampleRate = sampleRate_;
         // once per second
-        maxPeakTimer.setDivision(sampleRate);
+        maxPeakTimer.setDivision(std::max((int)sampleRate / division, 1));
+    }
+
+    // Trades meter resolution for CPU: 1 updates every sample.
+    void setDivision(int division_) {
+        if (division_ == division) {
+            return;
+        }
+        division = division_;
+        count = 0;
+        held = 0.0f;
+        onSampleRateChange(sampleRate);
     }
 
     void process(float deltaTime, float sample) {
 
+        if (division > 1) {
+            if (std::fabs(sample) > std::fabs(held)) {
+                held = sample;
+            }
+            if (++count < division) {
+                return;
+            }
+            sample = held;
+            deltaTime *= division;
+            count = 0;
+            held = 0.0f;
+        }
+
         peakMeter.process(deltaTime, sample);
         peak = peakMeter.v;
 
@@ -59,3 +59,40 @@ struct ArcMuteButton : SvgSwitch {
         shadow->box.pos = Vec(0.0, 1.5);
     }
 };
+
+// A small label on a panel, such as the governor's tier or CLIP's latency:
+// getText() in black on a rounded patch of `color`. Nothing is drawn while
+// the text is empty.
+struct ArcBadge : TransparentWidget {
+
+    NVGcolor color;
+
+    ArcBadge(NVGcolor color_, float width) : color(color_) {
+        box.size = Vec(width, 9.0f);
+    }
+
+    virtual std::string getText() = 0;
+
+    void draw(const DrawArgs& args) override {
+        std::string text = getText();
+        if (text.empty()) {
+            return;
+        }
+
+        nvgBeginPath(args.vg);
+        nvgRoundedRect(args.vg, 0.0f, 0.0f, box.size.x, box.size.y, 2.0f);
+        nvgFillColor(args.vg, color);
+        nvgFill(args.vg);
+
+        std::shared_ptr<window::Font> font =
+            APP->window->loadFont(asset::system("res/fonts/ShareTechMono-Regular.ttf"));
+        if (!font) {
+            return;
+        }
+        nvgFontFaceId(args.vg, font->handle);
+        nvgFontSize(args.vg, 8.0f);
+        nvgFillColor(args.vg, nvgRGB(0x00, 0x00, 0x00));
+        nvgTextAlign(args.vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+        nvgText(args.vg, box.size.x / 2.0f, box.size.y / 2.0f, text.c_str(), NULL);
+    }
+};
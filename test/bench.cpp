@@ -0,0 +1,329 @@
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "arc_clip.hpp"
+#include "arc_filter.hpp"
+#include "arc_kernels.hpp"
+
+using arc::dsp::Kernels;
+using arc::dsp::kKernelWidth;
+
+// Keeps the optimizer from discarding results.
+static volatile float sink;
+
+static const int kIterations = 2000000;
+
+//--------------------------------------------------------------
+// timing
+//--------------------------------------------------------------
+
+template <typename F> double nanosPerCall(F f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; i++) {
+        f(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / kIterations;
+}
+
+struct Inputs {
+    float in[kKernelWidth];
+    float amp[kKernelWidth];
+    float out[kKernelWidth];
+    float source[4 * kKernelWidth];
+    float buffer[4 * kKernelWidth];
+    float limit[4 * kKernelWidth];
+    float pitch[kKernelWidth];
+    float ratioCv[kKernelWidth];
+    float offsetCv[kKernelWidth];
+    float history[arc::dsp::kTruePeakTaps * 8];
+
+    Inputs() {
+        for (int i = 0; i < kKernelWidth; i++) {
+            in[i] = (float)rand() / RAND_MAX * 20.0f - 10.0f;
+            amp[i] = (float)rand() / RAND_MAX;
+            pitch[i] = (float)rand() / RAND_MAX * 4.0f - 2.0f;
+            ratioCv[i] = (float)rand() / RAND_MAX;
+            offsetCv[i] = (float)rand() / RAND_MAX;
+        }
+        for (int i = 0; i < 4 * kKernelWidth; i++) {
+            source[i] = (float)rand() / RAND_MAX * 20.0f - 10.0f;
+            limit[i] = 5.0f;
+        }
+        for (int i = 0; i < arc::dsp::kTruePeakTaps * 8; i++) {
+            history[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+        }
+    }
+};
+
+static const int kBenches = 4 + arc::dsp::kShapesLen;
+
+// Runs each module's 16-channel kernel through a table, and returns ns/call
+// for: TRACK4/GAIN gain stage, FM pitch, one TRACK4 strip's stereo true-peak
+// meter, one side of a saturating TRACK4 strip, then CLIP 4x for each shape.
+void bench(const Kernels& k, double* ns) {
+    Inputs x;
+
+    // The kernels are called through pointers, so the optimizer can't hoist
+    // them out of the loop even though their inputs don't change.
+    ns[0] = nanosPerCall([&](int) {
+        sink = k.gain(x.in, 1, x.amp, x.out, kKernelWidth);
+    });
+
+    arc::dsp::FmKernelArgs args = {x.pitch, x.ratioCv, x.offsetCv, 2.0f, 0.5f, 0.0f, 0.5f, true};
+    ns[1] = nanosPerCall([&](int) {
+        k.fmPitch(args, x.out, kKernelWidth);
+        sink = x.out[0];
+    });
+
+    ns[2] = nanosPerCall([&](int) {
+        float peaks[2];
+        k.truePeak(x.history, peaks);
+        sink = peaks[0];
+    });
+
+    float previous[kKernelWidth] = {};
+    float loud[kKernelWidth];
+    for (int i = 0; i < kKernelWidth; i++) {
+        loud[i] = x.in[i] * 1.5f;
+    }
+    ns[3] = nanosPerCall([&](int) {
+        sink = k.saturatingGain(loud, 1, x.amp, x.out, previous, kKernelWidth);
+    });
+
+    for (int s = 0; s < arc::dsp::kShapesLen; s++) {
+        ns[4 + s] = nanosPerCall([&](int) {
+            // start over each time, so repeated clipping can't decay into denormals
+            for (int j = 0; j < 4 * kKernelWidth; j++) {
+                x.buffer[j] = x.source[j];
+            }
+            k.shape[s](x.buffer, x.limit, 4 * kKernelWidth);
+            sink = x.buffer[0];
+        });
+    }
+}
+
+//--------------------------------------------------------------
+// cascade
+//--------------------------------------------------------------
+
+// Runs one channel of CLIP's 4x anti-aliasing lowpass over a run of
+// sub-samples, and returns ns per sub-sample. CLIP filters 4 at a time when
+// Rack hands it one frame, and up to 4 * ClipEngine::kChunkFrames given a
+// block.
+double benchCascade(const Kernels& k, int n) {
+    const double Q[6] = {0.50431448, 0.54119610, 0.63023621, 0.82133982, 1.3065630, 3.8306488};
+    arc::dsp::CascadeState cascade;
+    cascade.sections = 6;
+    for (int i = 0; i < 6; i++) {
+        arc::dsp::Biquad<double> biquad;
+        biquad.setLowpass(1.0f / 8.0f, Q[i]);
+        cascade.b0[i] = biquad.b[0];
+        cascade.b1[i] = biquad.b[1];
+        cascade.b2[i] = biquad.b[2];
+        cascade.a1[i] = biquad.a[0];
+        cascade.a2[i] = biquad.a[1];
+    }
+
+    float buffer[4 * kKernelWidth] = {};
+    int calls = 4 * kKernelWidth / n;
+    double ns = nanosPerCall([&](int i) {
+        // Zero-stuffed, as upsampling leaves it
+        for (int j = 0; j < calls * n; j += 4) {
+            buffer[j] = (float)(i & 1) * 4.0f;
+        }
+        for (int c = 0; c < calls; c++) {
+            k.cascade(cascade, buffer + c * n, buffer + c * n, n, 1);
+        }
+        sink = buffer[0];
+    });
+    return ns / (calls * n);
+}
+
+//--------------------------------------------------------------
+// CLIP block mode
+//--------------------------------------------------------------
+
+// Feeds CLIP one frame at a time, the way Rack does, and returns ns per
+// frame. With blockFrames of 0 each frame is processed as it arrives. Only
+// the first `voices` of the cable's channels carry sound; the rest are
+// silent.
+double benchClipBlocks(int blockFrames, int voices = kKernelWidth, int channels = kKernelWidth) {
+    const int kFrames = kIterations / 20;
+
+    arc::dsp::ClipEngine clip;
+    clip.onSampleRateChange(48000.0f);
+    arc::dsp::ClipBlockBuffer blocks;
+    blocks.setBlockFrames(blockFrames);
+
+    float in[kKernelWidth], out[kKernelWidth];
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < kFrames; f++) {
+        for (int ch = 0; ch < channels; ch++) {
+            in[ch] = (ch < voices) ? (float)((f + ch) % 37) - 18.0f : 0.0f;
+        }
+        blocks.process(clip, in, NULL, out, channels);
+        sink = out[0];
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / kFrames;
+}
+
+//--------------------------------------------------------------
+// harmonic profile
+//--------------------------------------------------------------
+
+// A sine that lands exactly on a DFT bin, so no window is needed. Its
+// harmonics up to the 9th fall below Nyquist; everything above folds back
+// onto bins that are not multiples of the fundamental.
+static const float kSampleRate = 48000.0f;
+static const int kLength = 4800;
+static const int kFundamentalBin = 251; // 2510 Hz
+
+static float shaped[kLength];
+static float shapedLimit[kLength];
+
+double binPower(int bin) {
+    double re = 0.0, im = 0.0;
+    for (int i = 0; i < kLength; i++) {
+        double phase = 2.0 * M_PI * bin * i / kLength;
+        re += shaped[i] * cos(phase);
+        im -= shaped[i] * sin(phase);
+    }
+    return re * re + im * im;
+}
+
+double dB(double powerRatio) {
+    return 10.0 * log10(std::max(powerRatio, 1e-20));
+}
+
+// Shapes a sine with the given peak, relative to the limit, at 1x, and
+// prints the level of H2-H7 and THD relative to the fundamental, along with
+// the total power of everything that aliased back below Nyquist. The modules
+// oversample by 4x, so this is the worst case, not what CLIP outputs.
+void profile(const Kernels& k, int s, float drive) {
+    for (int i = 0; i < kLength; i++) {
+        shaped[i] = drive * sinf(2.0f * M_PI * kFundamentalBin * i / kLength);
+        shapedLimit[i] = 1.0f;
+    }
+    k.shape[s](shaped, shapedLimit, kLength);
+
+    double fundamental = binPower(kFundamentalBin);
+    double harmonics = 0.0, total = 0.0;
+    double h[8] = {};
+
+    for (int bin = 1; bin < kLength / 2; bin++) {
+        double p = binPower(bin);
+        total += p;
+        if (bin % kFundamentalBin == 0) {
+            int n = bin / kFundamentalBin;
+            if (n > 1) {
+                harmonics += p;
+            }
+            if (n < 8) {
+                h[n] = p;
+            }
+        }
+    }
+    double aliases = total - fundamental - harmonics;
+
+    printf("%-12s %5.1f", arc::dsp::shapeName(s), drive);
+    for (int n = 2; n < 8; n++) {
+        printf(" %7.1f", dB(h[n] / fundamental));
+    }
+    printf(" %7.1f %7.1f\n", dB(harmonics / fundamental), dB(aliases / fundamental));
+}
+
+int main() {
+    const char* names[kBenches] = {
+        "TRACK4/GAIN gain", "FM pitch", "TRACK4 true peak", "TRACK4 saturation"};
+    char shapeNames[arc::dsp::kShapesLen][32];
+    for (int s = 0; s < arc::dsp::kShapesLen; s++) {
+        snprintf(shapeNames[s], sizeof(shapeNames[s]), "CLIP %s (4x)", arc::dsp::shapeName(s));
+        names[4 + s] = shapeNames[s];
+    }
+
+    const Kernels* base = arc::dsp::defaultKernels();
+    arc::dsp::selectKernels();
+    const Kernels* avx2 = arc::dsp::avx2Kernels();
+    bool haveAvx2 = avx2 && &arc::dsp::kernels() == avx2;
+
+    double baseNs[kBenches] = {}, avx2Ns[kBenches] = {};
+    bench(*base, baseNs);
+    if (haveAvx2) {
+        bench(*avx2, avx2Ns);
+    }
+
+    printf("16 channels, ns per sample\n\n");
+    printf("%-22s %10s %10s %8s\n", "kernel", base->name, haveAvx2 ? "AVX2" : "-", "gain");
+    for (int i = 0; i < kBenches; i++) {
+        if (haveAvx2) {
+            printf(
+                "%-22s %10.2f %10.2f %7.2fx\n",
+                names[i],
+                baseNs[i],
+                avx2Ns[i],
+                baseNs[i] / avx2Ns[i]);
+        } else {
+            printf("%-22s %10.2f %10s %8s\n", names[i], baseNs[i], "-", "-");
+        }
+    }
+
+    printf("\nCLIP 4x lowpass, one channel, ns per sub-sample\n\n");
+    printf("%-22s %10s %10s\n", "run", base->name, haveAvx2 ? "AVX2" : "-");
+    const int runs[] = {4, 16, 64};
+    for (int n : runs) {
+        char name[32];
+        snprintf(name, sizeof(name), "%d sub-samples", n);
+        if (haveAvx2) {
+            printf("%-22s %10.2f %10.2f\n", name, benchCascade(*base, n), benchCascade(*avx2, n));
+        } else {
+            printf("%-22s %10.2f %10s\n", name, benchCascade(*base, n), "-");
+        }
+    }
+
+    printf(
+        "\nCLIP Cubic (4x), 16 channels, %s kernels, ns per frame\n\n",
+        arc::dsp::kernels().name);
+    const int blockSizes[] = {0, 16, 32, 64};
+    for (int n : blockSizes) {
+        char name[32];
+        snprintf(name, sizeof(name), n ? "%d-frame blocks" : "frame by frame", n);
+        printf("%-22s %10.2f\n", name, benchClipBlocks(n));
+    }
+
+    printf("\nThe same, frame by frame, with some voices silent\n\n");
+    const int voiceCounts[] = {16, 8, 4, 1, 0};
+    for (int v : voiceCounts) {
+        char name[32];
+        snprintf(name, sizeof(name), "%d of 16 sounding", v);
+        printf("%-22s %10.2f\n", name, benchClipBlocks(0, v));
+    }
+
+    printf("\nThe same, frame by frame, on narrower cables\n\n");
+    const int widths[] = {1, 2, 4, 8};
+    for (int w : widths) {
+        char name[32];
+        snprintf(name, sizeof(name), "%d channel%s", w, (w == 1) ? "" : "s");
+        printf("%-22s %10.2f\n", name, benchClipBlocks(0, w, w));
+    }
+
+    printf(
+        "\n%.0f Hz sine at 1x, dB relative to the fundamental\n\n",
+        kSampleRate * kFundamentalBin / kLength);
+    printf("%-12s %5s", "shape", "drive");
+    for (int n = 2; n < 8; n++) {
+        printf("      H%d", n);
+    }
+    printf(" %7s %7s\n", "THD", "alias");
+    const float drives[] = {0.5f, 1.0f, 2.0f};
+    for (int s = 0; s < arc::dsp::kShapesLen; s++) {
+        for (float drive : drives) {
+            profile(*base, s, drive);
+        }
+    }
+}
@@ -0,0 +1,204 @@
+// Measures what each module's panel and widget SVGs cost Rack, without Rack:
+// how long it takes to build a module's widget the first time, when every
+// SVG has to be parsed, and the next time, when they come from Rack's cache,
+// and how much geometry the panel then draws every frame.
+//
+//   ./run-panel-bench ../res [old-res ...]
+//
+// Each directory gets its own table, so assets from another revision can be
+// compared against the current ones:
+//
+//   git archive <rev> res | tar -x -C /tmp/old
+//   ./run-panel-bench /tmp/old/res ../res
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+
+#define NANOSVG_IMPLEMENTATION
+#include "nanosvg.h"
+
+// As Window::loadSvg() parses them.
+static const char* kUnits = "px";
+static const float kDpi = 75.0f;
+
+static const int kRepeats = 50;
+
+//--------------------------------------------------------------
+// modules
+//--------------------------------------------------------------
+
+// A widget class and the SVGs it loads, one per frame.
+struct Component {
+    const char* svgs[2];
+};
+
+static const Component kPort = {{"poly-port.svg"}};
+static const Component kKnob18 = {{"knob18.svg"}};
+static const Component kKnob24 = {{"knob24.svg"}};
+static const Component kKnob45 = {{"knob45.svg"}};
+static const Component kMuteButton = {{"button-gray.svg", "button-orange.svg"}};
+static const Component kHSwitch = {{"hswitch-0.svg", "hswitch-1.svg"}};
+
+struct Placement {
+    const Component* component;
+    int count;
+};
+
+// What each ModuleWidget adds, as of src/*.cpp. Rack's screws come from
+// Rack's own resources, so they're left out.
+struct Panel {
+    const char* name;
+    const char* svg;
+    Placement placements[4];
+};
+
+// clang-format off
+static const Panel kPanels[] = {
+    {"ATV", "ATV.svg", {{&kPort, 8}, {&kKnob18, 2}}},
+    {"CLIP", "CLIP.svg", {{&kPort, 7}, {&kKnob24, 1}}},
+    {"FM", "FM.svg", {{&kPort, 8}, {&kKnob18, 2}, {&kKnob45, 2}, {&kHSwitch, 1}}},
+    {"GAIN", "GAIN.svg", {{&kPort, 7}, {&kKnob18, 1}, {&kKnob24, 1}, {&kMuteButton, 1}}},
+    {"TRACK4", "TRACK4.svg", {{&kPort, 34}, {&kKnob24, 10}, {&kMuteButton, 5}}},
+};
+// clang-format on
+
+//--------------------------------------------------------------
+// loading
+//--------------------------------------------------------------
+
+// Like Window's SVG cache: each path is parsed the first time it's asked
+// for, and looked up after that.
+class SvgCache {
+
+    std::map<std::string, NSVGimage*> images;
+
+  public:
+    ~SvgCache() {
+        clear();
+    }
+
+    void clear() {
+        for (auto& entry : images) {
+            nsvgDelete(entry.second);
+        }
+        images.clear();
+    }
+
+    NSVGimage* load(const std::string& path) {
+        auto it = images.find(path);
+        if (it != images.end()) {
+            return it->second;
+        }
+        NSVGimage* image = nsvgParseFromFile(path.c_str(), kUnits, kDpi);
+        images[path] = image;
+        return image;
+    }
+};
+
+struct Geometry {
+    int shapes = 0;
+    int points = 0;
+
+    void add(const NSVGimage* image, int count) {
+        if (!image) {
+            return;
+        }
+        for (NSVGshape* shape = image->shapes; shape != NULL; shape = shape->next) {
+            shapes += count;
+            for (NSVGpath* path = shape->paths; path != NULL; path = path->next) {
+                points += count * path->npts;
+            }
+        }
+    }
+};
+
+// Loads everything the module's widget would, and returns false if a file is
+// missing. Only the first frame of a switch is drawn until it's pressed.
+static bool buildWidget(SvgCache& cache, const std::string& dir, const Panel& panel, Geometry* g) {
+    NSVGimage* image = cache.load(dir + "/" + panel.svg);
+    if (!image) {
+        return false;
+    }
+    if (g) {
+        g->add(image, 1);
+    }
+    for (const Placement& p : panel.placements) {
+        if (!p.component) {
+            break;
+        }
+        for (int n = 0; n < p.count; n++) {
+            for (int f = 0; f < 2 && p.component->svgs[f]; f++) {
+                image = cache.load(dir + "/" + p.component->svgs[f]);
+                if (!image) {
+                    return false;
+                }
+                if (g && n == 0 && f == 0) {
+                    g->add(image, p.count);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static double micros(std::chrono::steady_clock::duration d) {
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+//--------------------------------------------------------------
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: run-panel-bench res-dir [res-dir ...]\n");
+        return 2;
+    }
+
+    for (int a = 1; a < argc; a++) {
+        std::string dir = argv[a];
+
+        std::printf("%s\n\n", dir.c_str());
+        std::printf(
+            "%-8s %12s %12s %8s %8s\n",
+            "module",
+            "cold (us)",
+            "cached (us)",
+            "shapes",
+            "points");
+
+        for (const Panel& panel : kPanels) {
+            SvgCache cache;
+            Geometry g;
+            if (!buildWidget(cache, dir, panel, &g)) {
+                std::printf("%-8s missing SVGs\n", panel.name);
+                continue;
+            }
+
+            // Cold: a fresh cache every time, so everything gets parsed.
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < kRepeats; i++) {
+                cache.clear();
+                buildWidget(cache, dir, panel, NULL);
+            }
+            double cold = micros(std::chrono::steady_clock::now() - start) / kRepeats;
+
+            // Cached: a second instance of the module.
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < kRepeats; i++) {
+                buildWidget(cache, dir, panel, NULL);
+            }
+            double cached = micros(std::chrono::steady_clock::now() - start) / kRepeats;
+
+            std::printf(
+                "%-8s %12.1f %12.2f %8d %8d\n",
+                panel.name,
+                cold,
+                cached,
+                g.shapes,
+                g.points);
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
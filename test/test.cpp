@@ -1,7 +1,42 @@
 
+#include <cassert>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <thread>
+#include <vector>
+
+#include "arc_atv.hpp"
+#include "arc_capture.hpp"
+#include "arc_clip.hpp"
+#include "arc_filter.hpp"
+#include "arc_fm.hpp"
+#include "arc_gain.hpp"
+#include "arc_kernels.hpp"
+#include "arc_loudness.hpp"
+#include "arc_quality.hpp"
+#include "arc_ramp.hpp"
+#include "arc_strip.hpp"
+#include "arc_truepeak.hpp"
+#include "arc_wav.hpp"
+#include "render.hpp"
+
+static int failures = 0;
+
+void check(bool ok, const char* what) {
+    std::cout << (ok ? "ok:   " : "FAIL: ") << what << std::endl;
+    if (!ok) {
+        failures++;
+    }
+}
+
+float randomIn(float lo, float hi) {
+    return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
 
 void dump(float v) {
     std::cout << std::fixed;
@@ -13,91 +48,1147 @@ void dump(float v) {
 // LinearRamp
 //--------------------------------------------------------------
 
-class LinearRamp {
+void testLinearRamp() {
+
+    arc::dsp::LinearRamp ramp;
+    ramp.setTime(0.005f);
+    ramp.onSampleRateChange(48000.0f);
+
+    for (int t = 0; t < 300; t++) {
+        std::cout << t << ": ";
+        float value = ramp.next(2.0f);
+        dump(value);
+        std::cout << std::endl;
+    }
+
+    std::cout << "-------------------" << std::endl;
+
+    for (int t = 0; t < 300; t++) {
+        std::cout << t << ": ";
+        float value = ramp.next(1.234567f);
+        dump(value);
+        std::cout << std::endl;
+    }
+}
+
+//--------------------------------------------------------------
+// Shapes
+//--------------------------------------------------------------
+
+float scalarShape(int s, float x) {
+    using namespace arc::dsp;
+    // clang-format off
+    switch (s) {
+        case kTanh:       return shape::Tanh::process(x);
+        case kAsymmetric: return shape::Asymmetric::process(x);
+        case kHard:       return shape::Hard::process(x);
+        default:          return shape::Cubic::process(x);
+    }
+    // clang-format on
+}
+
+// Every curve passes through 0 with unity slope, never decreases, and stays
+// within +/- 1 however hard it is driven.
+void testShapes() {
+
+    bool unity = true, monotonic = true, bounded = true;
+
+    for (int s = 0; s < arc::dsp::kShapesLen; s++) {
+        float slope = (scalarShape(s, 1e-3f) - scalarShape(s, -1e-3f)) / 2e-3f;
+        unity &= std::fabs(scalarShape(s, 0.0f)) < 1e-6f && std::fabs(slope - 1.0f) < 1e-3f;
+
+        float prev = scalarShape(s, -100.0f);
+        for (float x = -100.0f; x <= 100.0f; x += 0.01f) {
+            float y = scalarShape(s, x);
+            monotonic &= y >= prev - 1e-6f;
+            bounded &= std::fabs(y) <= 1.0f;
+            prev = y;
+        }
+    }
+
+    check(unity, "shapes have unity gain at 0");
+    check(monotonic, "shapes are monotonic");
+    check(bounded, "shapes are bounded");
+}
+
+//--------------------------------------------------------------
+// Cascade
+//--------------------------------------------------------------
+
+// Every run length, with and without the wavefront, against six Biquads in
+// series.
+void testCascade(const arc::dsp::Kernels& k) {
+    const int kStride = 3;
+    const int kMaxRun = 40;
+    const double Q[6] = {0.50431448, 0.54119610, 0.63023621, 0.82133982, 1.3065630, 3.8306488};
+    float buffer[kMaxRun * kStride];
 
-    float sampleRate = 1.0f;
-    float time = 1.0f; // in seconds
-    float divisor = 1.0f;
+    bool exact = true;
+    for (int n = 1; n <= kMaxRun; n++) {
+        arc::dsp::Biquad<double> serial[6];
+        arc::dsp::CascadeState cascade;
+        cascade.sections = 6;
+        for (int i = 0; i < 6; i++) {
+            serial[i].setLowpass(1.0f / 8.0f, Q[i]);
+            cascade.b0[i] = serial[i].b[0];
+            cascade.b1[i] = serial[i].b[1];
+            cascade.b2[i] = serial[i].b[2];
+            cascade.a1[i] = serial[i].a[0];
+            cascade.a2[i] = serial[i].a[1];
+        }
 
-    float target = 0.0f;
-    float increment = 0.0f;
-    float value = 0.0f;
+        // Several runs, so state carries from one run to the next.
+        for (int run = 0; run < 10; run++) {
+            for (int i = 0; i < n * kStride; i++) {
+                buffer[i] = randomIn(-10.0f, 10.0f);
+            }
+            float expect[kMaxRun];
+            for (int i = 0; i < n; i++) {
+                float v = buffer[i * kStride];
+                for (int j = 0; j < 6; j++) {
+                    v = serial[j].process(v);
+                }
+                expect[i] = v;
+            }
+            k.cascade(cascade, buffer, buffer, n, kStride);
+            for (int i = 0; i < n; i++) {
+                exact &= buffer[i * kStride] == expect[i];
+            }
+        }
+    }
+    check(exact, "cascade matches biquads in series exactly");
+}
+
+//--------------------------------------------------------------
+// Kernels
+//--------------------------------------------------------------
 
-    void recalc() {
-        divisor = 1.0f / (sampleRate * time);
+using arc::dsp::kKernelWidth;
+
+float maxDiff(const float* a, const float* b, int n) {
+    float d = 0.0f;
+    for (int i = 0; i < n; i++) {
+        d = std::max(d, std::fabs(a[i] - b[i]));
+    }
+    return d;
+}
+
+// Runs every kernel in k on the same random inputs, and checks the results
+// against straightforward scalar code.
+// Fills the lanes a kernel must leave alone.
+const float kSentinel = 123.0f;
+
+// Phases 0 and 1 of the BS.1770-4 true-peak filter, as printed in the
+// standard. Phases 2 and 3 are phases 1 and 0 reversed.
+// clang-format off
+const float kTruePeakPhase0[12] = {
+     0.0017089843750f,  0.0109863281250f, -0.0196533203125f,  0.0332031250000f,
+    -0.0594482421875f,  0.1373291015625f,  0.9721679687500f, -0.1022949218750f,
+     0.0476074218750f, -0.0266113281250f,  0.0148925781250f, -0.0083007812500f};
+const float kTruePeakPhase1[12] = {
+    -0.0291748046875f,  0.0292968750000f, -0.0517578125000f,  0.0891113281250f,
+    -0.1665039062500f,  0.4650878906250f,  0.7797851562500f, -0.2003173828125f,
+     0.1015625000000f, -0.0582275390625f,  0.0330810546875f, -0.0189208984375f};
+// clang-format on
+
+// The straightforward FIR: the largest of the four phases, for one side of
+// a history frame laid out the way the truePeak kernel wants it.
+float scalarTruePeak(const float* history, int side) {
+    float peak = 0.0f;
+    for (int phase = 0; phase < 4; phase++) {
+        float y = 0.0f;
+        for (int k = 0; k < 12; k++) {
+            float h = (phase == 0) ? kTruePeakPhase0[k]
+                      : (phase == 1) ? kTruePeakPhase1[k]
+                      : (phase == 2) ? kTruePeakPhase1[11 - k]
+                                     : kTruePeakPhase0[11 - k];
+            // x[n - k], where the newest frame is last
+            y += h * history[(11 - k) * 8 + side * 4];
+        }
+        peak = std::max(peak, std::fabs(y));
+    }
+    return peak;
+}
+
+//--------------------------------------------------------------
+// Saturation
+//--------------------------------------------------------------
+
+double cubicAntiderivative(double x) {
+    double a = std::fabs(x);
+    return (a <= 1.0) ? x * x / 2.0 - x * x * x * x / 12.0 : a * 2.0 / 3.0 - 0.25;
+}
+
+// Power at the frequency of the given bin of n samples.
+double binPower(const std::vector<float>& x, int bin) {
+    double re = 0.0, im = 0.0;
+    for (size_t i = 0; i < x.size(); i++) {
+        double phase = 2.0 * M_PI * bin * (double)i / (double)x.size();
+        re += x[i] * std::cos(phase);
+        im += x[i] * std::sin(phase);
     }
+    return re * re + im * im;
+}
 
-  public:
+// Frame by frame against the antiderivative worked out in double precision,
+// and then a sine driven well past 10V, whose harmonics above Nyquist must
+// fold back much more quietly than through the plain curve.
+void testSaturation(const arc::dsp::Kernels& k) {
 
-    void onSampleRateChange(float sampleRate_) {
-        assert(sampleRate_ > 0.0f);
-        sampleRate = sampleRate_;
-        recalc();
+    const double kScale = 15.0;
+
+    float amp[kKernelWidth], in[kKernelWidth] = {}, previous[kKernelWidth] = {};
+    double expectPrevious[kKernelWidth] = {};
+    for (int ch = 0; ch < kKernelWidth; ch++) {
+        amp[ch] = randomIn(0.0f, 4.0f);
     }
 
-    void setTime(float time_) {
-        assert(time_ > 0.0f);
-        time = time_;
-        recalc();
+    float worst = 0.0f;
+    bool bounded = true;
+    for (int frame = 0; frame < 2000; frame++) {
+        int channels = 1 + frame % kKernelWidth;
+
+        // Mostly small steps, which take the midpoint path.
+        float out[kKernelWidth], expect[kKernelWidth];
+        float expectSum = 0.0f;
+        for (int ch = 0; ch < kKernelWidth; ch++) {
+            in[ch] = (frame % 3 == 0) ? randomIn(-12.0f, 12.0f) : in[ch] + randomIn(-0.01f, 0.01f);
+            out[ch] = expect[ch] = kSentinel;
+        }
+        // Only the vectors that hold a channel are updated.
+        for (int ch = 0; ch < (channels + 7) / 8 * 8; ch++) {
+            double x = (ch < channels) ? (double)in[ch] * amp[ch] / kScale : 0.0;
+            double x1 = expectPrevious[ch];
+            double y = (std::fabs(x - x1) < 1e-3)
+                           ? arc::dsp::shape::Cubic::process((float)((x + x1) / 2.0))
+                           : (cubicAntiderivative(x) - cubicAntiderivative(x1)) / (x - x1);
+            expectPrevious[ch] = x;
+            if (ch < channels) {
+                expect[ch] = (float)(y * kScale);
+                expectSum += expect[ch];
+            }
+        }
+        float sum = k.saturatingGain(in, 1, amp, out, previous, channels);
+        worst = std::max(worst, maxDiff(out, expect, kKernelWidth));
+        worst = std::max(worst, std::fabs(sum - expectSum) / kKernelWidth);
+        for (int ch = 0; ch < channels; ch++) {
+            bounded &= std::fabs(out[ch]) <= 10.0f;
+        }
     }
 
-    float next(float target_) {
+    check(worst < 1e-4f, "saturatingGain matches the antiderivative");
+    check(bounded, "saturatingGain stays within 10V");
+
+    // 6970 Hz at 48 kHz, 4800 samples: 10 Hz bins, and every odd harmonic
+    // lands on one.
+    const int kSamples = 4800;
+    const int kBin = 697;
+    std::vector<float> plain(kSamples), adaa(kSamples);
+    float one = 1.0f, prev[kKernelWidth] = {};
+    for (int i = 0; i < kSamples; i++) {
+        float x = 30.0f * (float)std::sin(2.0 * M_PI * kBin * i / kSamples);
+        plain[i] = arc::dsp::shape::Cubic::process(x / 15.0f) * 15.0f;
+        k.saturatingGain(&x, 1, &one, &adaa[i], prev, 1);
+    }
 
-        // done already
-        if (target_ == value) {
-            return value;
+    double plainAliases = 0.0, adaaAliases = 0.0;
+    for (int h = 3; h < 40; h += 2) {
+        int bin = (h * kBin) % kSamples;
+        bin = std::min(bin, kSamples - bin);
+        if (h * kBin > kSamples / 2) {
+            plainAliases += binPower(plain, bin);
+            adaaAliases += binPower(adaa, bin);
         }
+    }
+    check(adaaAliases < plainAliases * 0.25, "saturatingGain folds back less than the plain curve");
+}
+
+void testKernelTable(const arc::dsp::Kernels& k) {
+
+    std::cout << "kernels: " << k.name << std::endl;
 
-        // new target
-        if (target != target_) {
-            target = target_;
-            increment = (target - value) * divisor;
+    float worstGain = 0.0f;
+    float worstClip = 0.0f;
+    float worstFm = 0.0f;
+    float worstTruePeak = 0.0f;
+
+    for (int trial = 0; trial < 1000; trial++) {
+        int channels = 1 + trial % kKernelWidth;
+
+        // gain, which must not write past the channel count
+        float in[kKernelWidth], amp[kKernelWidth];
+        float out[kKernelWidth], expect[kKernelWidth];
+        float expectSum = 0.0f;
+        for (int ch = 0; ch < kKernelWidth; ch++) {
+            in[ch] = randomIn(-12.0f, 12.0f);
+            amp[ch] = randomIn(0.0f, 2.0f);
+            out[ch] = expect[ch] = kSentinel;
+        }
+        for (int ch = 0; ch < channels; ch++) {
+            expect[ch] = std::min(std::max(in[ch] * amp[ch], -10.0f), 10.0f);
+            expectSum += expect[ch];
         }
+        float sum = k.gain(in, 1, amp, out, channels);
+        worstGain = std::max(worstGain, maxDiff(out, expect, kKernelWidth));
+        worstGain = std::max(worstGain, std::fabs(sum - expectSum) / kKernelWidth);
 
-        // increment the value
-        bool rising = (target > value);
-        value += increment;
+        // shape, against the scalar curves
+        const int kFrames = 4;
+        float limit[kFrames * kKernelWidth];
+        for (int i = 0; i < kFrames * kKernelWidth; i++) {
+            limit[i] = randomIn(0.1f, 10.0f);
+        }
+        for (int s = 0; s < arc::dsp::kShapesLen; s++) {
+            float buffer[kFrames * kKernelWidth], shapeExpect[kFrames * kKernelWidth];
+            for (int i = 0; i < kFrames * kKernelWidth; i++) {
+                buffer[i] = randomIn(-20.0f, 20.0f);
+                shapeExpect[i] = scalarShape(s, buffer[i] / limit[i]) * limit[i];
+            }
+            k.shape[s](buffer, limit, kFrames * kKernelWidth);
+            worstClip = std::max(worstClip, maxDiff(buffer, shapeExpect, kFrames * kKernelWidth));
+        }
 
-        // rising
-        if (rising) {
-            if (value > target) {
-                value = target;
+        // fmPitch, which must not write past the channel count either
+        float pitch[kKernelWidth], ratioCv[kKernelWidth], offsetCv[kKernelWidth];
+        float fm[kKernelWidth];
+        for (int ch = 0; ch < kKernelWidth; ch++) {
+            pitch[ch] = randomIn(-5.0f, 5.0f);
+            ratioCv[ch] = randomIn(-10.0f, 10.0f);
+            offsetCv[ch] = randomIn(-10.0f, 10.0f);
+            fm[ch] = kSentinel;
+        }
+        arc::dsp::FmKernelArgs args = {
+            pitch,
+            ratioCv,
+            offsetCv,
+            randomIn(0.01f, 10.0f),
+            randomIn(-1.0f, 1.0f),
+            randomIn(-5.0f, 5.0f),
+            randomIn(-1.0f, 1.0f),
+            (trial & 1) == 0};
+        k.fmPitch(args, fm, channels);
+        for (int ch = channels; ch < kKernelWidth; ch++) {
+            worstFm = std::max(worstFm, std::fabs(fm[ch] - kSentinel));
+        }
+        for (int ch = 0; ch < channels; ch++) {
+            float ratio = args.ratio + ratioCv[ch] * args.ratioCvAmount;
+            if (args.quantizeRatio) {
+                // clang-format off
+                if      (ratio < 0.1875f) ratio = 0.125f;
+                else if (ratio < 0.375f)  ratio = 0.25f;
+                else if (ratio < 0.75f)   ratio = 0.5f;
+                else                      ratio = std::round(ratio);
+                // clang-format on
             }
+            float offset = (args.offset + offsetCv[ch] * args.offsetCvAmount) * 40.0f;
+            float carrierFreq = powf(2.0f, pitch[ch]) * 261.6256f;
+            float modFreq = std::min(std::max(carrierFreq * ratio + offset, 20.0f), 20000.0f);
+            worstFm = std::max(worstFm, std::fabs(fm[ch] - log2f(modFreq / 261.6256f)));
         }
-        // falling
-        else {
-            if (value < target) {
-                value = target;
+
+        // truePeak
+        float history[arc::dsp::kTruePeakTaps * 8];
+        for (int f = 0; f < arc::dsp::kTruePeakTaps; f++) {
+            float left = randomIn(-2.0f, 2.0f), right = randomIn(-2.0f, 2.0f);
+            for (int i = 0; i < 4; i++) {
+                history[f * 8 + i] = left;
+                history[f * 8 + 4 + i] = right;
             }
         }
+        float peaks[2];
+        k.truePeak(history, peaks);
+        worstTruePeak = std::max(worstTruePeak, std::fabs(peaks[0] - scalarTruePeak(history, 0)));
+        worstTruePeak = std::max(worstTruePeak, std::fabs(peaks[1] - scalarTruePeak(history, 1)));
+    }
+
+    check(worstGain < 1e-5f, "gain matches scalar code");
+    check(worstClip < 1e-5f, "shapes match scalar code");
+    check(worstFm < 1e-5f, "fmPitch matches scalar code");
+    check(worstTruePeak < 1e-5f, "truePeak matches scalar code");
+
+    testCascade(k);
+    testSaturation(k);
+}
+
+// The default and AVX2 tables must agree exactly.
+void testKernelEquivalence(const arc::dsp::Kernels& a, const arc::dsp::Kernels& b) {
+
+    bool same = true;
+
+    for (int trial = 0; trial < 1000; trial++) {
+        int channels = 1 + trial % kKernelWidth;
+
+        float in[kKernelWidth], amp[kKernelWidth];
+        float outA[kKernelWidth] = {}, outB[kKernelWidth] = {};
+        for (int ch = 0; ch < kKernelWidth; ch++) {
+            in[ch] = randomIn(-12.0f, 12.0f);
+            amp[ch] = randomIn(0.0f, 2.0f);
+        }
+        int stride = trial % 3 == 0 ? 0 : 1;
+        same &= a.gain(in, stride, amp, outA, channels) == b.gain(in, stride, amp, outB, channels);
+        same &= maxDiff(outA, outB, kKernelWidth) == 0.0f;
+
+        float prevA[kKernelWidth] = {}, prevB[kKernelWidth] = {};
+        for (int ch = 0; ch < kKernelWidth; ch++) {
+            prevA[ch] = prevB[ch] = randomIn(-1.0f, 1.0f);
+        }
+        same &= a.saturatingGain(in, stride, amp, outA, prevA, channels) ==
+                b.saturatingGain(in, stride, amp, outB, prevB, channels);
+        same &= maxDiff(outA, outB, kKernelWidth) == 0.0f;
+        same &= maxDiff(prevA, prevB, kKernelWidth) == 0.0f;
+
+        // a run that ends mid-vector must leave the rest alone
+        float bufA[4 * kKernelWidth], bufB[4 * kKernelWidth], limit[4 * kKernelWidth];
+        for (int i = 0; i < 4 * kKernelWidth; i++) {
+            bufA[i] = bufB[i] = randomIn(-20.0f, 20.0f);
+            limit[i] = randomIn(0.1f, 10.0f);
+        }
+        int run = 1 + trial % (4 * kKernelWidth);
+        for (int i = run; i < 4 * kKernelWidth; i++) {
+            bufA[i] = bufB[i] = kSentinel;
+        }
+        for (int s = 0; s < arc::dsp::kShapesLen; s++) {
+            a.shape[s](bufA, limit, run);
+            b.shape[s](bufB, limit, run);
+            same &= maxDiff(bufA, bufB, 4 * kKernelWidth) == 0.0f;
+            same &= run == 4 * kKernelWidth || bufA[4 * kKernelWidth - 1] == kSentinel;
+        }
+
+        float pitch[kKernelWidth], ratioCv[kKernelWidth], offsetCv[kKernelWidth];
+        for (int ch = 0; ch < kKernelWidth; ch++) {
+            pitch[ch] = randomIn(-5.0f, 5.0f);
+            ratioCv[ch] = randomIn(-10.0f, 10.0f);
+            offsetCv[ch] = randomIn(-10.0f, 10.0f);
+        }
+        arc::dsp::FmKernelArgs args = {
+            pitch, ratioCv, offsetCv, 2.5f, 0.3f, 1.0f, -0.5f, (trial & 1) == 0};
+        float fmA[kKernelWidth], fmB[kKernelWidth];
+        a.fmPitch(args, fmA, channels);
+        b.fmPitch(args, fmB, channels);
+        same &= maxDiff(fmA, fmB, channels) == 0.0f;
+
+        float history[arc::dsp::kTruePeakTaps * 8];
+        for (int i = 0; i < arc::dsp::kTruePeakTaps * 8; i++) {
+            history[i] = randomIn(-2.0f, 2.0f);
+        }
+        float peaksA[2], peaksB[2];
+        a.truePeak(history, peaksA);
+        b.truePeak(history, peaksB);
+        same &= maxDiff(peaksA, peaksB, 2) == 0.0f;
+    }
+
+    check(same, "default and AVX2 kernels are bit-identical");
+}
+
+void testKernels() {
 
-        return value;
+    testKernelTable(*arc::dsp::defaultKernels());
+
+    arc::dsp::selectKernels();
+    const arc::dsp::Kernels* avx2 = arc::dsp::avx2Kernels();
+    if (avx2 && &arc::dsp::kernels() == avx2) {
+        testKernelTable(*avx2);
+        testKernelEquivalence(*arc::dsp::defaultKernels(), *avx2);
+    } else {
+        std::cout << "skipped: AVX2 kernels are not available here" << std::endl;
+    }
+}
+
+//--------------------------------------------------------------
+// Engines
+//--------------------------------------------------------------
+
+// Runs one engine over a block, and a copy of it one frame at a time, the way
+// the Rack modules drive it. Both must produce the same output, and neither
+// may write past the end of a tightly packed buffer.
+template <typename Engine, typename Setup>
+bool blockMatchesFrames(Engine& block, Engine& frames, int channels, Setup setup) {
+
+    const int kFrames = 200;
+    int samples = kFrames * channels;
+
+    std::vector<float> in(samples), cv(samples);
+    for (int i = 0; i < samples; i++) {
+        in[i] = randomIn(-10.0f, 10.0f);
+        cv[i] = randomIn(0.0f, 10.0f);
+    }
+
+    // one extra sample at the end, which must stay untouched
+    std::vector<float> outBlock(samples + 1, kSentinel);
+    std::vector<float> outFrames(samples + 1, kSentinel);
+
+    setup(block, cv.data());
+    block.processBlock(in.data(), outBlock.data(), kFrames, channels);
+
+    for (int f = 0; f < kFrames; f++) {
+        int base = f * channels;
+        setup(frames, cv.data() + base);
+        frames.processBlock(in.data() + base, outFrames.data() + base, 1, channels);
+    }
+
+    return outBlock == outFrames && outBlock[samples] == kSentinel;
+}
+
+// Adapts the stereo strip to the mono signature above, with the left and
+// right outputs side by side in one buffer.
+struct StripPair {
+    arc::dsp::StripEngine strip;
+    std::vector<float> right;
+
+    void processBlock(const float* in, float* out, int frames, int channels) {
+        right.assign(frames * channels, 0.0f);
+        strip.processBlock(in, in, out, right.data(), frames, channels);
+        for (int i = 0; i < frames * channels; i++) {
+            out[i] -= right[i];
+        }
     }
 };
 
-void testLinearRamp() {
+void testEngines() {
+    using arc::dsp::ClipEngine;
+    using arc::dsp::FmEngine;
+    using arc::dsp::GainEngine;
 
-    LinearRamp ramp;
-    ramp.setTime(0.005f);
-    ramp.onSampleRateChange(48000.0f);
+    const float kSampleRate = 48000.0f;
+    bool gainOk = true, stripOk = true, clipOk = true, fmOk = true;
 
-    for (int t = 0; t < 300; t++) {
-        std::cout << t << ": ";
-        float value = ramp.next(2.0f);
-        dump(value);
-        std::cout << std::endl;
+    for (int channels = 1; channels <= kKernelWidth; channels++) {
+
+        GainEngine gainA, gainB;
+        gainA.onSampleRateChange(kSampleRate);
+        gainB.onSampleRateChange(kSampleRate);
+        gainOk &= blockMatchesFrames(gainA, gainB, channels, [](GainEngine& e, float* cv) {
+            e.level = 6.0f;
+            e.levelCv = cv;
+        });
+        gainOk &= gainA.sum == gainB.sum;
+
+        StripPair stripA, stripB;
+        stripA.strip.onSampleRateChange(kSampleRate);
+        stripB.strip.onSampleRateChange(kSampleRate);
+        stripOk &= blockMatchesFrames(stripA, stripB, channels, [=](StripPair& e, float* cv) {
+            e.strip.level = -3.0f;
+            e.strip.pan = 0.4f;
+            e.strip.levelCv = cv;
+            e.strip.panCv = cv;
+            e.strip.saturate = (channels % 2) == 0;
+        });
+        stripOk &= stripA.strip.leftSum == stripB.strip.leftSum;
+
+        ClipEngine clipA, clipB;
+        clipA.onSampleRateChange(kSampleRate);
+        clipB.onSampleRateChange(kSampleRate);
+        clipOk &= blockMatchesFrames(clipA, clipB, channels, [](ClipEngine& e, float* cv) {
+            e.level = 0.0f;
+            e.shape = arc::dsp::kTanh;
+            e.levelCv = cv;
+        });
+
+        FmEngine fmA, fmB;
+        fmOk &= blockMatchesFrames(fmA, fmB, channels, [](FmEngine& e, float* cv) {
+            e.ratio = 1.5f;
+            e.ratioCvAmount = 0.1f;
+            e.quantizeRatio = false;
+            e.ratioCv = cv;
+        });
     }
 
-    std::cout << "-------------------" << std::endl;
+    check(gainOk, "gain engine: a block matches frame by frame");
+    check(stripOk, "strip engine: a block matches frame by frame");
+    check(clipOk, "clip engine: a block matches frame by frame");
+    check(fmOk, "fm engine: a block matches frame by frame");
 
-    for (int t = 0; t < 300; t++) {
-        std::cout << t << ": ";
-        float value = ramp.next(1.234567f);
-        dump(value);
-        std::cout << std::endl;
+    arc::dsp::AttenuverterEngine atv;
+    atv.amount = -0.5f;
+    float in[3] = {2.0f, -4.0f, 8.0f}, out[4] = {0.0f, 0.0f, 0.0f, kSentinel};
+    atv.processBlock(in, out, 1, 3);
+    check(
+        out[0] == -1.0f && out[1] == 2.0f && out[2] == -4.0f && out[3] == kSentinel,
+        "attenuverter engine scales by its amount");
+
+    // Uneven stereo, the way TRACK-4 widens it: 2 voices on the left and 4 on
+    // the right. The left keeps its own 2 voices and is silent above them.
+    // A mono left would be applied to all 4.
+    arc::dsp::StripEngine strip;
+    strip.onSampleRateChange(kSampleRate);
+    float left[2] = {1.0f, -2.0f}, right[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+    float leftSpread[kKernelWidth], monoSpread[kKernelWidth];
+    const float* wide = arc::dsp::spreadChannels(left, 2, 4, leftSpread);
+    const float* mono = arc::dsp::spreadChannels(left, 1, 4, monoSpread);
+    float outLeft[4], outRight[4];
+    strip.processBlock(wide, right, outLeft, outRight, 1, 4);
+    check(
+        wide[0] == 1.0f && wide[1] == -2.0f && wide[2] == 0.0f && wide[3] == 0.0f &&
+            mono[0] == 1.0f && mono[1] == 1.0f && mono[2] == 1.0f && mono[3] == 1.0f,
+        "strip spread keeps polyphonic voices and broadcasts mono");
+    check(
+        outLeft[1] == -2.0f * outLeft[0] && outLeft[2] == 0.0f && outLeft[3] == 0.0f &&
+            strip.leftSum == outLeft[0] + outLeft[1] && outLeft[0] != 0.0f,
+        "strip engine: uneven stereo keeps each side's voices");
+}
+
+//--------------------------------------------------------------
+// ClipBlockBuffer
+//--------------------------------------------------------------
+
+// Fed a frame at a time, the buffer must match the engine given the whole
+// run as one block, delayed by exactly one block, with or without level CV.
+void testClipBlocks() {
+    using arc::dsp::ClipBlockBuffer;
+    using arc::dsp::ClipEngine;
+
+    const float kSampleRate = 48000.0f;
+    const int kChannels = 5;
+    const int kFrames = 300;
+
+    std::vector<float> in(kFrames * kChannels), cv(kFrames * kChannels);
+    for (int i = 0; i < kFrames * kChannels; i++) {
+        in[i] = randomIn(-10.0f, 10.0f);
+        cv[i] = randomIn(0.0f, 10.0f);
+    }
+
+    bool delayed = true, direct = true;
+    const int blockSizes[] = {0, 16, 32, 64};
+    for (int n : blockSizes) {
+        for (int withCv = 0; withCv < 2; withCv++) {
+            ClipEngine whole, framed;
+            whole.onSampleRateChange(kSampleRate);
+            framed.onSampleRateChange(kSampleRate);
+            whole.levelCv = withCv ? cv.data() : NULL;
+
+            std::vector<float> expect(kFrames * kChannels);
+            whole.processBlock(in.data(), expect.data(), kFrames, kChannels);
+
+            ClipBlockBuffer blocks;
+            blocks.setBlockFrames(n);
+            bool ok = blocks.getBlockFrames() == n;
+            for (int f = 0; f < kFrames; f++) {
+                const float* frameCv = withCv ? cv.data() + f * kChannels : NULL;
+                float out[kKernelWidth];
+                int channels =
+                    blocks.process(framed, in.data() + f * kChannels, frameCv, out, kChannels);
+
+                if (f < n) {
+                    ok &= out[0] == 0.0f;
+                    continue;
+                }
+                ok &= channels == kChannels;
+                for (int ch = 0; ch < kChannels; ch++) {
+                    ok &= out[ch] == expect[(f - n) * kChannels + ch];
+                }
+            }
+            (n == 0 ? direct : delayed) &= ok;
+        }
+    }
+
+    check(direct, "clip blocks: off runs each frame as it arrives");
+    check(delayed, "clip blocks: output is delayed by exactly one block");
+
+    // Reset partway through a block, as when the output is unplugged: the
+    // next block's worth of output is silent, not what was queued before.
+    ClipEngine engine;
+    engine.onSampleRateChange(kSampleRate);
+    ClipBlockBuffer blocks;
+    blocks.setBlockFrames(16);
+    bool cleared = true;
+    float out[kKernelWidth];
+    for (int f = 0; f < 40; f++) {
+        blocks.process(engine, in.data() + f * kChannels, NULL, out, kChannels);
+    }
+    blocks.reset();
+    for (int f = 40; f < 56; f++) {
+        blocks.process(engine, in.data() + f * kChannels, NULL, out, kChannels);
+        for (int ch = 0; ch < kChannels; ch++) {
+            cleared &= out[ch] == 0.0f;
+        }
+    }
+    blocks.process(engine, in.data() + 56 * kChannels, NULL, out, kChannels);
+    check(cleared && out[0] != 0.0f, "clip blocks: reset drops what was queued");
+
+    // Bypassed, the input comes out untouched, a block late.
+    ClipBlockBuffer bypassed;
+    bypassed.setBlockFrames(32);
+    bool untouched = true;
+    for (int f = 0; f < kFrames; f++) {
+        int channels = bypassed.bypass(in.data() + f * kChannels, out, kChannels);
+        for (int ch = 0; ch < kChannels && f >= 32; ch++) {
+            untouched &= channels == kChannels && out[ch] == in[(f - 32) * kChannels + ch];
+        }
+    }
+    check(untouched, "clip blocks: bypass is delayed by one block too");
+}
+
+// On a 16-channel cable with two voices sounding, only those two are
+// processed, and they come out exactly as they would on a cable of their
+// own. A voice that stops is dropped once its filters have rung out.
+void testClipActivity() {
+    using arc::dsp::ClipEngine;
+
+    const float kSampleRate = 48000.0f;
+    const int kFrames = 4800;
+    const int kVoices[2] = {2, 9};
+
+    ClipEngine wide, narrow;
+    wide.onSampleRateChange(kSampleRate);
+    narrow.onSampleRateChange(kSampleRate);
+
+    std::vector<float> wideIn(kFrames * kKernelWidth, 0.0f), wideOut(kFrames * kKernelWidth);
+    std::vector<float> narrowIn(kFrames * 2), narrowOut(kFrames * 2);
+    for (int f = 0; f < kFrames; f++) {
+        for (int v = 0; v < 2; v++) {
+            // The second voice stops a quarter of the way through.
+            float x = (v == 1 && f >= kFrames / 4) ? 0.0f : 8.0f * std::sin(0.03f * f * (v + 1));
+            wideIn[f * kKernelWidth + kVoices[v]] = x;
+            narrowIn[f * 2 + v] = x;
+        }
+    }
+
+    bool counted = true, packed = true, silent = true, dropped = false;
+    float tail = 0.0f;
+    for (int start = 0; start < kFrames; start += ClipEngine::kChunkFrames) {
+        int n = ClipEngine::kChunkFrames;
+        wide.processBlock(&wideIn[start * kKernelWidth], &wideOut[start * kKernelWidth], n, 16);
+        narrow.processBlock(&narrowIn[start * 2], &narrowOut[start * 2], n, 2);
+
+        uint32_t mask = wide.getActiveMask();
+        counted &= (mask & ~((1u << 2) | (1u << 9))) == 0 && (mask & (1u << 2));
+        counted &= wide.getActiveChannels() == ((mask & (1u << 9)) ? 2 : 1);
+
+        for (int f = start; f < start + n; f++) {
+            for (int ch = 0; ch < kKernelWidth; ch++) {
+                float out = wideOut[f * kKernelWidth + ch];
+                if (ch == kVoices[0] || (ch == kVoices[1] && !dropped)) {
+                    packed &= out == narrowOut[f * 2 + (ch == kVoices[1] ? 1 : 0)];
+                } else {
+                    silent &= out == 0.0f;
+                }
+            }
+        }
+        if (!dropped && !(mask & (1u << 9))) {
+            dropped = true;
+            tail = std::fabs(narrowOut[(start - 1) * 2 + 1]);
+        }
+    }
+
+    check(counted, "clip activity: only sounding voices are processed");
+    check(packed, "clip activity: packed voices match a cable of their own");
+    check(silent, "clip activity: skipped voices are silent");
+    check(dropped && tail < 1e-6f, "clip activity: a stopped voice is dropped once it rings out");
+}
+
+// Whether a voice is dropped, and when it comes back, mustn't depend on how
+// the stream is split into calls. Each voice has a gap that starts and ends
+// off the chunk boundaries.
+void testClipCallSize() {
+    using arc::dsp::ClipEngine;
+
+    const int kFrames = 3000;
+    const int kChannels = 3;
+    const int kGapStart[kChannels] = {700, 333, 1001};
+    const int kGapEnd[kChannels] = {2201, 2500, 1999};
+
+    std::vector<float> in(kFrames * kChannels);
+    for (int f = 0; f < kFrames; f++) {
+        for (int ch = 0; ch < kChannels; ch++) {
+            bool gap = f >= kGapStart[ch] && f < kGapEnd[ch];
+            in[f * kChannels + ch] = gap ? 0.0f : 8.0f * std::sin(0.05f * f * (ch + 1));
+        }
+    }
+
+    bool same = true, dropped = false;
+    for (int s = 0; s < arc::dsp::kShapesLen; s++) {
+        ClipEngine live, block, odd;
+        ClipEngine* engines[3] = {&live, &block, &odd};
+        for (ClipEngine* c : engines) {
+            c->onSampleRateChange(48000.0f);
+            c->shape = s;
+            c->level = 6.0f;
+        }
+
+        std::vector<float> liveOut(kFrames * kChannels), blockOut(kFrames * kChannels);
+        std::vector<float> oddOut(kFrames * kChannels);
+        for (int f = 0; f < kFrames; f++) {
+            live.processBlock(&in[f * kChannels], &liveOut[f * kChannels], 1, kChannels);
+            dropped |= live.getActiveChannels() == 0;
+        }
+        block.processBlock(&in[0], &blockOut[0], kFrames, kChannels);
+        for (int f = 0; f < kFrames; f += 7) {
+            int n = std::min(7, kFrames - f);
+            odd.processBlock(&in[f * kChannels], &oddOut[f * kChannels], n, kChannels);
+        }
+
+        same &= maxDiff(&liveOut[0], &blockOut[0], kFrames * kChannels) == 0.0f;
+        same &= maxDiff(&liveOut[0], &oddOut[0], kFrames * kChannels) == 0.0f;
+    }
+
+    check(dropped, "clip call size: voices are dropped in their gaps");
+    check(same, "clip call size: output is the same one frame at a time or in blocks");
+}
+
+//--------------------------------------------------------------
+// TruePeak
+//--------------------------------------------------------------
+
+// A sine at a quarter of the sample rate, sampled 45 degrees off its peaks,
+// never has a sample above 0.707, but its true peak is 1.
+void testTruePeak() {
+    arc::dsp::TruePeak truePeak;
+
+    float samplePeak = 0.0f, leftPeak = 0.0f, rightPeak = 0.0f;
+    for (int n = 0; n < 1000; n++) {
+        float x = sinf(M_PI / 2.0f * n + M_PI / 4.0f);
+        truePeak.process(x, 0.5f * x);
+        if (n >= arc::dsp::kTruePeakTaps) {
+            samplePeak = std::max(samplePeak, std::fabs(x));
+            leftPeak = std::max(leftPeak, truePeak.left);
+            rightPeak = std::max(rightPeak, truePeak.right);
+        }
+    }
+
+    auto db = [](float x) { return 20.0f * std::log10(x); };
+    check(samplePeak < 0.71f, "true peak: the samples miss the peak");
+    check(std::fabs(db(leftPeak)) < 0.1f, "true peak: finds the peak between samples");
+    check(std::fabs(db(rightPeak / 0.5f)) < 0.1f, "true peak: sides are independent");
+
+    truePeak.reset();
+    check(truePeak.left == 0.0f && truePeak.right == 0.0f, "true peak: reset clears");
+    truePeak.process(0.0f, 0.0f);
+    check(truePeak.left == 0.0f && truePeak.right == 0.0f, "true peak: reset clears history");
+}
+
+//--------------------------------------------------------------
+// Loudness
+//--------------------------------------------------------------
+
+// Feeds a 997Hz sine to either side for the given number of seconds.
+void feedSine(arc::dsp::Loudness& loudness, float left, float right, float seconds, int& n) {
+    const float kSampleRate = 48000.0f;
+    for (int end = n + (int)(seconds * kSampleRate); n < end; n++) {
+        float x = sinf(2.0f * M_PI * 997.0f / kSampleRate * n);
+        loudness.process(left * x, right * x);
+    }
+}
+
+void testLoudness() {
+    arc::dsp::Loudness loudness;
+    loudness.onSampleRateChange(48000.0f);
+    int n = 0;
+
+    check(loudness.getIntegrated() == arc::dsp::Loudness::kSilence, "loudness: starts silent");
+
+    // BS.1770's reference: a full scale 1kHz sine in one channel is -3.01.
+    feedSine(loudness, 1.0f, 0.0f, 3.5f, n);
+    check(std::fabs(loudness.getMomentary() + 3.01f) < 0.05f, "loudness: momentary reference");
+    check(std::fabs(loudness.getShortTerm() + 3.01f) < 0.05f, "loudness: short-term reference");
+
+    // 20s at -20 LUFS, then 20s at -40: the relative gate drops the quiet
+    // half, and the absolute gate drops the silence after it.
+    loudness.resetIntegrated();
+    feedSine(loudness, 0.1f, 0.1f, 20.0f, n);
+    feedSine(loudness, 0.01f, 0.01f, 20.0f, n);
+    feedSine(loudness, 0.0f, 0.0f, 10.0f, n);
+    check(std::fabs(loudness.getIntegrated() + 20.0f) < 0.1f, "loudness: integrated is gated");
+    check(
+        loudness.getMomentary() == arc::dsp::Loudness::kSilence, "loudness: silence reads silent");
+
+    // Momentary follows a step within 400ms, short-term takes 3s.
+    feedSine(loudness, 0.1f, 0.1f, 0.5f, n);
+    check(std::fabs(loudness.getMomentary() + 20.0f) < 0.1f, "loudness: momentary is 400ms");
+    check(loudness.getShortTerm() < -25.0f, "loudness: short-term is slower");
+    feedSine(loudness, 0.1f, 0.1f, 2.6f, n);
+    check(std::fabs(loudness.getShortTerm() + 20.0f) < 0.1f, "loudness: short-term is 3s");
+
+    loudness.resetIntegrated();
+    feedSine(loudness, 0.0f, 0.0f, 0.2f, n);
+    check(loudness.getIntegrated() == arc::dsp::Loudness::kSilence, "loudness: reset integrated");
+}
+
+//--------------------------------------------------------------
+// Quality
+//--------------------------------------------------------------
+
+void testGovernor() {
+    using arc::dsp::Governor;
+
+    Governor governor;
+    double now = 0.0;
+
+    // A frame every 1/60 of a second, for the given number of seconds.
+    auto run = [&](float load, double seconds) {
+        for (double end = now + seconds; now < end; now += 1.0 / 60.0) {
+            governor.update(now, load);
+        }
+    };
+
+    run(0.95f, 0.4);
+    check(governor.getTier() == arc::dsp::kTierFull, "governor ignores a short spike");
+    run(0.95f, 0.2);
+    check(governor.getTier() == arc::dsp::kTierOversample, "governor steps down under load");
+    run(0.95f, 0.6);
+    check(governor.getTier() == arc::dsp::kTierMeters, "governor keeps stepping down");
+    run(0.95f, 10.0);
+    check(governor.getTier() == arc::dsp::kTierTables, "governor stops at the lowest tier");
+
+    run(0.7f, 10.0);
+    check(governor.getTier() == arc::dsp::kTierTables, "governor holds between thresholds");
+    run(0.3f, 3.9);
+    check(governor.getTier() == arc::dsp::kTierTables, "governor is slow to step up");
+    run(0.3f, 0.2);
+    check(governor.getTier() == arc::dsp::kTierControlRate, "governor steps up when idle");
+    run(0.3f, 20.0);
+    check(governor.getTier() == arc::dsp::kTierFull, "governor returns to full quality");
+}
+
+void testGainTables() {
+    const arc::dsp::GainTables& tables = arc::dsp::gainTables();
+
+    bool levelOk = true;
+    for (float db = -59.0f; db <= 36.0f; db += 0.37f) {
+        float error = 20.0f * std::log10(tables.amplitude(db) / arc::dsp::decibelsToAmplitude(db));
+        levelOk = levelOk && std::fabs(error) <= 0.13f;
+    }
+    check(levelOk, "gain tables: level within an eighth of a dB");
+    check(tables.amplitude(-60.0f) == 0.0f, "gain tables: silent at the bottom of the range");
+
+    float panError = 0.0f;
+    for (float pan = -1.0f; pan <= 1.0f; pan += 0.013f) {
+        float lr = (pan + 1.0f) * 0.125f;
+        panError = std::max(panError, std::fabs(tables.left(pan) - cosf(2.0f * M_PI * lr)));
+        panError = std::max(panError, std::fabs(tables.right(pan) - sinf(2.0f * M_PI * lr)));
+    }
+    check(panError < 0.02f, "gain tables: pan within 0.02");
+
+    arc::dsp::ClipEngine clip;
+    clip.onSampleRateChange(48000.0f);
+    clip.setOversample(2);
+    clip.coarse = true;
+    float in[4] = {-12.0f, -1.0f, 3.0f, 20.0f}, out[5] = {0, 0, 0, 0, kSentinel};
+    bool clipOk = clip.getOversample() == 2;
+    for (int f = 0; f < 1000; f++) {
+        clip.processBlock(in, out, 1, 4);
+        for (int ch = 0; ch < 4; ch++) {
+            clipOk = clipOk && std::isfinite(out[ch]) && std::fabs(out[ch]) < 12.0f;
+        }
+    }
+    check(clipOk && out[4] == kSentinel, "clip engine runs at 2x with coarse tables");
+}
+
+//--------------------------------------------------------------
+// WAV files
+//--------------------------------------------------------------
+
+// Writes frames of interleaved voltages as a float WAV, the way arc-render
+// writes its outputs.
+void writeStem(const char* path, const std::vector<float>& voltages, int channels) {
+    std::FILE* file = std::fopen(path, "wb");
+    uint32_t frames = voltages.size() / channels;
+    arc::dsp::writeWavHeader(file, 48000, channels, frames);
+    for (float v : voltages) {
+        float sample = v / 10.0f;
+        std::fwrite(&sample, sizeof(float), 1, file);
+    }
+    std::fclose(file);
+}
+
+std::vector<float> readStem(const char* path) {
+    std::vector<float> samples;
+    std::FILE* file = std::fopen(path, "rb");
+    if (file) {
+        std::fseek(file, arc::dsp::kWavHeaderSize, SEEK_SET);
+        float sample;
+        while (std::fread(&sample, sizeof(float), 1, file) == 1) {
+            samples.push_back(sample);
+        }
+        std::fclose(file);
+    }
+    return samples;
+}
+
+//--------------------------------------------------------------
+// Capture
+//--------------------------------------------------------------
+
+// Captures a few blocks and a partial one, playing the part of the audio
+// thread, then reads the file back.
+void testCapture() {
+    using arc::dsp::Capture;
+
+    const int kFrames = Capture::kBlockFrames * 5 + 123;
+    std::vector<float> volts(kFrames * 2);
+    std::vector<float> expect(kFrames * 2);
+    for (int i = 0; i < kFrames * 2; i++) {
+        volts[i] = randomIn(-10.0f, 10.0f);
+        expect[i] = volts[i] / 10.0f;
+    }
+
+    Capture capture;
+    bool started = capture.start("out.wav", 48000);
+    check(started, "capture starts");
+    if (!started) {
+        return;
+    }
+    check(!capture.start("out.wav", 48000), "capture refuses a second start");
+
+    for (int f = 0; f < kFrames; f++) {
+        capture.process(volts[f * 2], volts[f * 2 + 1]);
+    }
+    capture.stop();
+    while (capture.isBusy()) {
+        capture.process(0.0f, 0.0f);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    check(capture.getDropped() == 0 && !capture.isFull(), "capture drops nothing");
+
+    std::FILE* file = std::fopen("out.wav", "rb");
+    unsigned char header[58];
+    std::vector<float> actual(kFrames * 2 + 1);
+    size_t n = 0;
+    if (file) {
+        if (std::fread(header, 1, sizeof(header), file) == sizeof(header)) {
+            n = std::fread(actual.data(), sizeof(float), actual.size(), file);
+        }
+        std::fclose(file);
+    }
+
+    uint32_t dataSize = header[54] | header[55] << 8 | header[56] << 16 | header[57] << 24;
+    check(
+        n == expect.size() && std::memcmp(header, "RIFF", 4) == 0 &&
+            dataSize == expect.size() * sizeof(float),
+        "capture writes a complete WAV file");
+    check(
+        n == expect.size() && std::memcmp(actual.data(), expect.data(), n * sizeof(float)) == 0,
+        "capture is bit-exact, scaled as arc-render scales");
+
+    // Stopped while the audio thread isn't running, as when the module is
+    // bypassed: the writer gives up waiting and ends the file with the last
+    // full block.
+    check(capture.start("out.wav", 48000), "capture restarts");
+    for (int f = 0; f < kFrames; f++) {
+        capture.process(volts[f * 2], volts[f * 2 + 1]);
+    }
+    capture.stop();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (capture.isBusy() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::vector<float> full = readStem("out.wav");
+    size_t fullSize = (kFrames / Capture::kBlockFrames) * Capture::kBlockFrames * 2;
+    check(
+        !capture.isBusy() && full.size() == fullSize &&
+            std::memcmp(full.data(), expect.data(), fullSize * sizeof(float)) == 0,
+        "capture finishes without the audio thread");
+    check(capture.start("out.wav", 48000), "capture starts again after that");
+    capture.stop();
+}
+
+//--------------------------------------------------------------
+// Render
+//--------------------------------------------------------------
+
+// Renders a chain and a TRACK-4 mix, and checks them against the engines
+// driven one frame at a time, the way the modules drive them live.
+void testRender() {
+    using namespace arc::render;
+
+    // An odd length, so the last block is partial.
+    const int kFrames = 10000;
+    const int kChannels = 3;
+
+    // Voltages that survive the trip through the file exactly.
+    std::vector<float> stem(kFrames * kChannels), mono(kFrames);
+    for (int i = 0; i < kFrames * kChannels; i++) {
+        stem[i] = (randomIn(-10.0f, 10.0f) / 10.0f) * 10.0f;
+    }
+    for (int f = 0; f < kFrames; f++) {
+        mono[f] = stem[f * kChannels];
+    }
+    writeStem("out.stem.wav", stem, kChannels);
+    writeStem("out.mono.wav", mono, 1);
+
+    // chain
+    Job chain;
+    chain.input = "out.stem.wav";
+    chain.output = "out.chain.wav";
+    chain.chain.resize(2);
+    chain.chain[0].module = Stage::kGain;
+    chain.chain[0].level = -3.0f;
+    chain.chain[0].boost = 12.0f;
+    chain.chain[1].module = Stage::kClip;
+    chain.chain[1].shape = arc::dsp::kAsymmetric;
+    chain.chain[1].blockFrames = 32;
+
+    std::string error;
+    check(runJob(chain, error), "render runs a chain");
+
+    arc::dsp::GainEngine gain;
+    arc::dsp::ClipEngine clip;
+    gain.onSampleRateChange(48000.0f);
+    clip.onSampleRateChange(48000.0f);
+    gain.level = -3.0f + 12.0f;
+    clip.shape = arc::dsp::kAsymmetric;
+
+    // As in Rack, CLIP gets what GAIN wrote to the cable a frame earlier,
+    // and in block mode puts it out a block later.
+    arc::dsp::ClipBlockBuffer blocks;
+    blocks.setBlockFrames(32);
+    std::vector<float> expect(kFrames * kChannels);
+    float cable[kChannels] = {};
+    for (int f = 0; f < kFrames; f++) {
+        float frame[kChannels] = {};
+        float* in = &stem[f * kChannels];
+        blocks.process(clip, cable, NULL, frame, kChannels);
+        gain.processBlock(in, cable, 1, kChannels);
+        for (int ch = 0; ch < kChannels; ch++) {
+            expect[f * kChannels + ch] = frame[ch] / 10.0f;
+        }
+    }
+    check(readStem("out.chain.wav") == expect, "a rendered chain is bit-identical");
+
+    // TRACK-4, with a mono file on track 2 and nothing on the others
+    Job mix;
+    mix.track4 = true;
+    mix.output = "out.mix.wav";
+    mix.tracks[1].input = "out.mono.wav";
+    mix.tracks[1].level = -6.0f;
+    mix.tracks[1].pan = 0.3f;
+    mix.mix.level = 2.0f;
+    check(runJob(mix, error), "render runs a TRACK-4 mix");
+
+    arc::dsp::StripEngine track, mixTrack;
+    track.onSampleRateChange(48000.0f);
+    mixTrack.onSampleRateChange(48000.0f);
+    track.level = -6.0f;
+    track.pan = 0.3f;
+    mixTrack.level = 2.0f;
+
+    expect.resize(kFrames * 2);
+    for (int f = 0; f < kFrames; f++) {
+        float out[4];
+        float in = mono[f];
+        track.processBlock(&in, &in, out, out + 1, 1, 1);
+
+        float mixLeft[4] = {0.0f, track.leftSum, 0.0f, 0.0f};
+        float mixRight[4] = {0.0f, track.rightSum, 0.0f, 0.0f};
+        mixTrack.processBlock(mixLeft, mixRight, mixLeft, mixRight, 1, 4);
+        expect[f * 2] = mixTrack.leftSum / 10.0f;
+        expect[f * 2 + 1] = mixTrack.rightSum / 10.0f;
     }
+    check(readStem("out.mix.wav") == expect, "a rendered mix is bit-identical");
 }
 
 int main() {
     testLinearRamp();
+    testShapes();
+    testKernels();
+    testEngines();
+    testClipBlocks();
+    testClipActivity();
+    testClipCallSize();
+    testTruePeak();
+    testLoudness();
+    testGovernor();
+    testGainTables();
+    testCapture();
+    testRender();
+    return failures ? 1 : 0;
 }